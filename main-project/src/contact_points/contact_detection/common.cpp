@@ -1,58 +1,162 @@
 #include "include/common.hpp" 
+#include "include/ParallelUtils.h"
 #include <fstream>
 #include <iostream>
+#include <stdexcept>
 
-// --- Image3D Method Implementations ---
+// --- Algorithm Implementations ---
 
-int& Image3D::at(long i, long j, long k) {
-    // Calculates the 1D index from 3D coordinates.
-    return data[k + z_dim * (j + y_dim * i)];
-}
+// Explicit template instantiations
+template Volume<int> erosion<int>(const Volume<int>&);
+template Volume<uint8_t> erosion<uint8_t>(const Volume<uint8_t>&);
+template Volume<uint16_t> erosion<uint16_t>(const Volume<uint16_t>&);
+template Volume<uint32_t> erosion<uint32_t>(const Volume<uint32_t>&);
+template void erosion_into<int>(const Volume<int>&, Volume<int>&, unsigned);
+template void erosion_into<uint8_t>(const Volume<uint8_t>&, Volume<uint8_t>&, unsigned);
+template void erosion_into<uint16_t>(const Volume<uint16_t>&, Volume<uint16_t>&, unsigned);
+template void erosion_into<uint32_t>(const Volume<uint32_t>&, Volume<uint32_t>&, unsigned);
+
+namespace {
 
-const int& Image3D::at(long i, long j, long k) const {
-    // Calculates the 1D index from 3D coordinates (const version).
-    return data[k + z_dim * (j + y_dim * i)];
+/**
+ * @brief Erodes one row of `n` voxels given the rows of its 4 in-plane and out-of-plane neighbors.
+ *
+ * Neighbor rows outside the image are replaced by a row of non-zero voxels, so the loop over
+ * the interior of the row has no bounds checks and no branches and is vectorized by the
+ * compiler. Only the two end voxels of the row are handled separately.
+ */
+template<typename T>
+void erode_row(const T* c, const T* up, const T* down, const T* left, const T* right, T* out, size_t n) {
+    auto keep_across = [&](size_t k) {
+        return (up[k] != 0) & (down[k] != 0) & (left[k] != 0) & (right[k] != 0);
+    };
+    if (n == 1) {
+        out[0] = keep_across(0) ? c[0] : T(0);
+        return;
+    }
+    out[0] = (keep_across(0) & (c[1] != 0)) ? c[0] : T(0);
+    for (size_t k = 1; k + 1 < n; ++k) {
+        const bool keep = (c[k - 1] != 0) & (c[k + 1] != 0) & (up[k] != 0) & (down[k] != 0) &
+                          (left[k] != 0) & (right[k] != 0);
+        out[k] = keep ? c[k] : T(0);
+    }
+    out[n - 1] = (keep_across(n - 1) & (c[n - 2] != 0)) ? c[n - 1] : T(0);
 }
 
+} // namespace
 
-// --- Algorithm Implementations ---
+template<typename T>
+void erosion_into(const Volume<T>& grains, Volume<T>& eroded, unsigned num_threads) {
+    if (!grains.data.empty() && grains.data.data() == eroded.data.data()) {
+        throw std::invalid_argument("Error: erosion_into() cannot erode a volume in place.");
+    }
+    if (eroded.data.size() != grains.data.size()) {
+        eroded.data = VoxelBuffer<T>::uninitialized(grains.data.size());
+    }
+    eroded.x_dim = grains.x_dim;
+    eroded.y_dim = grains.y_dim;
+    eroded.z_dim = grains.z_dim;
 
-Image3D erosion(const Image3D& grains) {
-    Image3D eroded = grains; // Start with a copy of the original image.
-    
-    // Offsets for 6-connectivity neighborhood (up, down, left, right, front, back).
-    const int offsets[6][3] = {
-        {-1, 0, 0}, {1, 0, 0}, {0, -1, 0},
-        {0, 1, 0}, {0, 0, -1}, {0, 0, 1}
-    };
+    const size_t nx = grains.x_dim, ny = grains.y_dim, nz = grains.z_dim;
+    const size_t slice = ny * nz;
+    if (nx == 0 || slice == 0) return;
+
+    // Stand-in for the neighbor rows that fall outside the image: never erodes anything.
+    const std::vector<T> outside(nz, T(1));
+    const T* in = grains.data.data();
+    T* out = eroded.data.data();
 
-    for (long i = 0; i < grains.x_dim; ++i) {
-        for (long j = 0; j < grains.y_dim; ++j) {
-            for (long k = 0; k < grains.z_dim; ++k) {
-                // Skip background pixels.
-                if (grains.at(i, j, k) == 0) continue;
-
-                // Check all 6 neighbors.
-                for (const auto& offset : offsets) {
-                    long ni = i + offset[0];
-                    long nj = j + offset[1];
-                    long nk = k + offset[2];
-
-                    // Check if neighbor is within image bounds.
-                    if (ni >= 0 && ni < grains.x_dim && nj >= 0 && nj < grains.y_dim && nk >= 0 && nk < grains.z_dim) {
-                        // If a neighbor is background, this pixel is eroded.
-                        if (grains.at(ni, nj, nk) == 0) {
-                            eroded.at(i, j, k) = 0;
-                            break; // Move to the next pixel once eroded.
-                        }
-                    }
-                }
+    // Each worker erodes a slab of slices; it only reads the input, so slabs need no halo exchange.
+    parallel_for_chunks(0, nx, num_threads, [&](size_t i_begin, size_t i_end, unsigned) {
+        for (size_t i = i_begin; i < i_end; ++i) {
+            const T* s = in + i * slice;
+            const T* up_slice = i > 0 ? s - slice : nullptr;
+            const T* down_slice = i + 1 < nx ? s + slice : nullptr;
+            for (size_t j = 0; j < ny; ++j) {
+                const size_t row = j * nz;
+                erode_row(s + row,
+                          up_slice ? up_slice + row : outside.data(),
+                          down_slice ? down_slice + row : outside.data(),
+                          j > 0 ? s + row - nz : outside.data(),
+                          j + 1 < ny ? s + row + nz : outside.data(),
+                          out + i * slice + row, nz);
             }
         }
-    }
+    });
+}
+
+template<typename T>
+Volume<T> erosion(const Volume<T>& grains) {
+    Volume<T> eroded;
+    erosion_into(grains, eroded);
     return eroded;
 }
 
+// --- Incremental Erosion ---
+
+namespace {
+
+/**
+ * @brief Calls f(neighbor_index) for the in-bounds 6-neighbors of a flat voxel index.
+ */
+template<typename T, typename F>
+inline void for_each_neighbor(const Volume<T>& v, size_t idx, F&& f) {
+    const size_t nz = v.z_dim, ny = v.y_dim, nx = v.x_dim, slice = ny * nz;
+    const size_t k = idx % nz, j = (idx / nz) % ny, i = idx / slice;
+    if (i > 0) f(idx - slice);
+    if (i + 1 < nx) f(idx + slice);
+    if (j > 0) f(idx - nz);
+    if (j + 1 < ny) f(idx + nz);
+    if (k > 0) f(idx - 1);
+    if (k + 1 < nz) f(idx + 1);
+}
+
+} // namespace
+
+template<typename T>
+IncrementalErosion<T>::IncrementalErosion(Volume<T> grains, unsigned num_threads)
+    : current_(std::move(grains)), queued_(current_.data.size(), 0) {
+    const size_t nx = current_.x_dim, slice = size_t(current_.y_dim) * current_.z_dim;
+    const unsigned workers = resolve_thread_count(num_threads, nx);
+    std::vector<std::vector<size_t>> partial(workers);
+
+    // The first frontier is every foreground voxel touching the background.
+    parallel_for_chunks(0, nx, workers, [&](size_t i_begin, size_t i_end, unsigned w) {
+        for (size_t idx = i_begin * slice; idx < i_end * slice; ++idx) {
+            if (current_.data[idx] == 0) continue;
+            bool boundary = false;
+            for_each_neighbor(current_, idx, [&](size_t n) { boundary |= (current_.data[n] == 0); });
+            if (boundary) partial[w].push_back(idx);
+        }
+    });
+    for (const auto& part : partial) {
+        frontier_.insert(frontier_.end(), part.begin(), part.end());
+    }
+    for (size_t idx : frontier_) queued_[idx] = 1;
+}
+
+template<typename T>
+const std::vector<size_t>& IncrementalErosion<T>::step() {
+    removed_.swap(frontier_);
+    frontier_.clear();
+    if (removed_.empty()) return removed_;
+
+    // The whole frontier is removed at once, as in one erosion() pass.
+    for (size_t idx : removed_) current_.data[idx] = 0;
+
+    // Only the neighbors of the voxels just removed can have gained a background neighbor.
+    for (size_t idx : removed_) {
+        for_each_neighbor(current_, idx, [&](size_t n) {
+            if (current_.data[n] != 0 && !queued_[n]) {
+                queued_[n] = 1;
+                frontier_.push_back(n);
+            }
+        });
+    }
+    ++level_;
+    return removed_;
+}
+
 void save_results(const std::map<std::pair<int, int>, int>& contactsStrength, const std::string& outputPath) {
     // Open the output file for writing.
     std::ofstream file(outputPath);
@@ -70,4 +174,34 @@ void save_results(const std::map<std::pair<int, int>, int>& contactsStrength, co
         int strength = pair.second;
         file << contact_pair.first << "," << contact_pair.second << "," << strength << "\n";
     }
-}
\ No newline at end of file
+}
+
+std::map<std::pair<int, int>, int> contact_strengths(const std::map<std::pair<int, int>, ContactStats>& stats) {
+    std::map<std::pair<int, int>, int> strengths;
+    for (const auto& pair : stats) {
+        strengths.emplace_hint(strengths.end(), pair.first, pair.second.strength);
+    }
+    return strengths;
+}
+
+void save_contact_statistics(const std::map<std::pair<int, int>, ContactStats>& stats, const std::string& outputPath) {
+    std::ofstream file(outputPath);
+    if (!file.is_open()) {
+        std::cerr << "Error: Could not open output file: " << outputPath << std::endl;
+        return;
+    }
+
+    file << "Label1,Label2,ContactStrength,FaceCount,CentroidX,CentroidY,CentroidZ,NormalX,NormalY,NormalZ\n";
+    for (const auto& pair : stats) {
+        const auto& c = pair.second;
+        file << pair.first.first << "," << pair.first.second << "," << c.strength << "," << c.face_count << ","
+             << c.centroid[0] << "," << c.centroid[1] << "," << c.centroid[2] << ","
+             << c.normal[0] << "," << c.normal[1] << "," << c.normal[2] << "\n";
+    }
+}
+
+// Explicit class template instantiations (after the definitions, so every member is emitted)
+template class IncrementalErosion<int>;
+template class IncrementalErosion<uint8_t>;
+template class IncrementalErosion<uint16_t>;
+template class IncrementalErosion<uint32_t>;
@@ -0,0 +1,186 @@
+#include "include/connected_components.hpp"
+#include "include/ParallelUtils.h"
+
+#include <algorithm>
+#include <array>
+#include <limits>
+#include <stdexcept>
+#include <utility>
+#include <vector>
+
+// Explicit template instantiations
+template Labels3D label_connected_components<int>(const Volume<int>&, int, size_t&, unsigned);
+template Labels3D label_connected_components<uint8_t>(const Volume<uint8_t>&, int, size_t&, unsigned);
+template Labels3D label_connected_components<uint32_t>(const Volume<uint32_t>&, int, size_t&, unsigned);
+
+namespace {
+
+/**
+ * @brief Returns the neighbour offsets (di, dj, dk) that precede a voxel in raster order.
+ */
+std::vector<std::array<int, 3>> backward_offsets(int connectivity) {
+    std::vector<std::array<int, 3>> offsets;
+    for (int di = -1; di <= 0; ++di) {
+        for (int dj = -1; dj <= 1; ++dj) {
+            for (int dk = -1; dk <= 1; ++dk) {
+                const bool before = di < 0 || (di == 0 && (dj < 0 || (dj == 0 && dk < 0)));
+                const int order = (di != 0) + (dj != 0) + (dk != 0);
+                if (!before) continue;
+                if ((connectivity == 6 && order > 1) || (connectivity == 18 && order > 2)) continue;
+                offsets.push_back({di, dj, dk});
+            }
+        }
+    }
+    return offsets;
+}
+
+/**
+ * @brief The provisional labeling of one slab of slices.
+ */
+struct Slab {
+    size_t i_begin = 0, i_end = 0;
+    LabelEquivalences sets; ///< The slab's provisional labels, then their local component.
+    uint32_t count = 0;         ///< Number of components of the slab alone.
+    uint32_t offset = 0;        ///< Global index of the slab's first component.
+};
+
+} // namespace
+
+// --- LabelEquivalences ---
+
+LabelEquivalences::LabelEquivalences(size_t count) : parent_(count) {
+    for (size_t x = 0; x < count; ++x) parent_[x] = static_cast<uint32_t>(x);
+}
+
+uint32_t LabelEquivalences::add() {
+    const uint32_t label = static_cast<uint32_t>(parent_.size());
+    parent_.push_back(label);
+    return label;
+}
+
+uint32_t LabelEquivalences::find(uint32_t x) {
+    while (parent_[x] != x) {
+        parent_[x] = parent_[parent_[x]];
+        x = parent_[x];
+    }
+    return x;
+}
+
+uint32_t LabelEquivalences::unite(uint32_t a, uint32_t b) {
+    a = find(a);
+    b = find(b);
+    if (a > b) std::swap(a, b);
+    parent_[b] = a;
+    return a;
+}
+
+uint32_t LabelEquivalences::compact() {
+    // Roots are the smallest label of their set, so parent_[x] < x has already been numbered.
+    uint32_t count = 0;
+    for (uint32_t x = 0; x < parent_.size(); ++x) {
+        parent_[x] = parent_[x] == x ? count++ : parent_[parent_[x]];
+    }
+    return count;
+}
+
+// --- Labeling ---
+
+template<typename T>
+Labels3D label_connected_components(const Volume<T>& image, int connectivity, size_t& num_components,
+                                    unsigned num_threads) {
+    if (connectivity != 6 && connectivity != 18 && connectivity != 26) {
+        throw std::invalid_argument("Error: Component connectivity must be 6, 18 or 26.");
+    }
+    if (image.size() >= std::numeric_limits<uint32_t>::max()) {
+        throw std::invalid_argument("Error: Volume too large for 32-bit labels; use the out-of-core labeling.");
+    }
+
+    const size_t nx = image.x_dim, ny = image.y_dim, nz = image.z_dim;
+    const size_t slice = ny * nz;
+    const auto offsets = backward_offsets(connectivity);
+    Labels3D labels = allocate_volume<uint32_t>(image.x_dim, image.y_dim, image.z_dim);
+    uint32_t* label = labels.data.data();
+    const T* in = image.data.data();
+
+    const unsigned workers = resolve_thread_count(num_threads, nx);
+    std::vector<Slab> slabs(workers);
+
+    // --- Pass 1: provisional labels, one equivalence table per slab ---
+    // A provisional label is (first voxel of the slab) + (local label) + 1, so labels of different slabs never collide.
+    parallel_for_chunks(0, nx, workers, [&](size_t i_begin, size_t i_end, unsigned w) {
+        Slab& slab = slabs[w];
+        slab.i_begin = i_begin;
+        slab.i_end = i_end;
+        const uint32_t base = static_cast<uint32_t>(i_begin * slice);
+
+        for (size_t i = i_begin; i < i_end; ++i) {
+            for (size_t j = 0; j < ny; ++j) {
+                for (size_t k = 0; k < nz; ++k) {
+                    const size_t v = k + nz * (j + ny * i);
+                    if (in[v] == 0) {
+                        label[v] = 0;
+                        continue;
+                    }
+                    uint32_t best = std::numeric_limits<uint32_t>::max();
+                    for (const auto& o : offsets) {
+                        // Neighbours before the slab wait for pass 2; j - 1 and k - 1 wrap around past the bounds.
+                        if ((o[0] < 0 && i == i_begin) || j + o[1] >= ny || k + o[2] >= nz) continue;
+                        const uint32_t neighbor = label[v + o[0] * long(slice) + o[1] * long(nz) + o[2]];
+                        if (neighbor == 0) continue;
+                        const uint32_t local = neighbor - base - 1;
+                        best = best == std::numeric_limits<uint32_t>::max() ? slab.sets.find(local)
+                                                                            : slab.sets.unite(best, local);
+                    }
+                    if (best == std::numeric_limits<uint32_t>::max()) best = slab.sets.add();
+                    label[v] = base + best + 1;
+                }
+            }
+        }
+        slab.count = slab.sets.compact();
+    });
+
+    uint32_t total = 0;
+    for (Slab& slab : slabs) {
+        slab.offset = total;
+        total += slab.count;
+    }
+    auto component_of = [&](const Slab& slab, size_t v) {
+        return slab.offset + slab.sets.set_of(static_cast<uint32_t>(label[v] - slab.i_begin * slice - 1));
+    };
+
+    // --- Pass 2: equivalences across slab faces, collected in parallel and merged globally ---
+    std::vector<std::vector<std::pair<uint32_t, uint32_t>>> faces(workers);
+    parallel_for(1, workers, workers, [&](size_t w) {
+        const Slab& slab = slabs[w];
+        const Slab& previous = slabs[w - 1];
+        const size_t i = slab.i_begin;
+        for (size_t j = 0; j < ny; ++j) {
+            for (size_t k = 0; k < nz; ++k) {
+                const size_t v = k + nz * (j + ny * i);
+                if (label[v] == 0) continue;
+                for (const auto& o : offsets) {
+                    if (o[0] == 0 || j + o[1] >= ny || k + o[2] >= nz) continue;
+                    const size_t u = v - slice + o[1] * long(nz) + o[2];
+                    if (label[u] == 0) continue;
+                    std::pair<uint32_t, uint32_t> pair{component_of(previous, u), component_of(slab, v)};
+                    if (faces[w].empty() || faces[w].back() != pair) faces[w].push_back(pair);
+                }
+            }
+        }
+    });
+
+    LabelEquivalences global(total);
+    for (const auto& face : faces) {
+        for (const auto& pair : face) global.unite(pair.first, pair.second);
+    }
+    num_components = global.compact();
+
+    // --- Pass 3: final labels ---
+    parallel_for(0, workers, workers, [&](size_t w) {
+        const Slab& slab = slabs[w];
+        for (size_t v = slab.i_begin * slice; v < slab.i_end * slice; ++v) {
+            if (label[v] != 0) label[v] = global.set_of(component_of(slab, v)) + 1;
+        }
+    });
+    return labels;
+}
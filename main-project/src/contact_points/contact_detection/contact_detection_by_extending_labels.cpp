@@ -1,155 +1,85 @@
 #include "include/contact_detection_by_extending_labels.hpp"
 #include "include/common.hpp"
+#include "include/connected_components.hpp"
+#include "include/ImageProcessingUtils.h"
+#include "include/label_propagation.hpp"
+#include "include/minTree.hpp"
+#include "include/ParallelUtils.h"
+#include "include/stage_graph.hpp"
+#include "include/tiff_binary_sum.hpp"
+#include "include/volume_xtensor.hpp"
 
+#include <algorithm>
 #include <iostream>
+#include <stdexcept>
 #include <string>
-#include <vector>
-#include <cstdlib> // For system()
-#include <fstream>
-#include <sstream>
 #include <map>
-#include <set>
-#include <deque>
-#include <algorithm>
-#include <tuple>
-
-// --- Internal Helper Structures & Functions ---
-
-/**
- * @brief A simple struct to hold 3D integer coordinates.
- * Overloads operator< to allow storage in std::set.
- */
-struct Voxel {
-    int i, j, k;
-
-    bool operator<(const Voxel& other) const {
-        return std::tie(i, j, k) < std::tie(other.i, other.j, other.k);
-    }
-};
-
-// --- I/O Placeholders (TO BE IMPLEMENTED) ---
-
-// IMPORTANT: This is a placeholder. A real implementation requires a TIFF/RAW library.
-Image3D loadTiffImage(const std::string& path) {
-    std::cout << "WARNING: Function 'loadTiffImage' is a placeholder. Returning empty image." << std::endl;
-    return {};
-}
-Image3D loadRawImage(const std::string& path, int x, int y, int z) {
-    std::cout << "WARNING: Function 'loadRawImage' is a placeholder. Returning empty image." << std::endl;
-    return {};
-}
-std::map<int, Voxel> loadCentroids(const std::string& path) {
-    std::map<int, Voxel> centroids;
-    std::ifstream file(path);
-    std::string line;
-    if (!file.is_open()) {
-        std::cerr << "Error opening centroids file: " << path << std::endl;
-        return centroids;
-    }
-    std::getline(file, line); // Skip header
-    while (std::getline(file, line)) {
-        std::stringstream ss(line);
-        std::string value;
-        Voxel v;
-        int label;
-        std::getline(ss, value, ','); v.i = std::stoi(value);
-        std::getline(ss, value, ','); v.j = std::stoi(value);
-        std::getline(ss, value, ','); v.k = std::stoi(value);
-        std::getline(ss, value, ','); label = std::stoi(value);
-        centroids[label] = v;
-    }
-    return centroids;
-}
-
-// Helper to get 6-connectivity neighbors for a given voxel.
-std::vector<Voxel> get_neighbors(const Voxel& v) {
-    return {
-        {v.i - 1, v.j, v.k}, {v.i + 1, v.j, v.k},
-        {v.i, v.j - 1, v.k}, {v.i, v.j + 1, v.k},
-        {v.i, v.j, v.k - 1}, {v.i, v.j, v.k + 1}
-    };
-}
-
 
 // --- Main Module Logic ---
 
-void run_contact_detection_by_extending_labels() {
+void run_contact_detection_by_extending_labels(unsigned num_threads) {
     
     // --- 1. Argument Parsing (Hardcoded Placeholders) ---
     std::string grainsPath = "../data/grains.tif";
-    int x = 100, y = 100, z = 100;
-    std::string threshold = "27000";
-    bool keep_files = false;
-    std::string pinkDir = "../Pink/linux/bin/";
+    int threshold = 27000;
     std::string outputPath = "../results/contacts_extending_labels.csv";
 
-    // --- 2. Pre-processing via External Tools ---
+    // --- 2. Pre-processing: In-Process Stage Graph ---
     std::cout << "--- Module: Contact Detection by Extending Labels ---" << std::endl;
-    std::cout << "Starting pre-processing using external scripts..." << std::endl;
-    
-    system("mkdir -p tmp");
-    system(("python3 ../utils/minTree.py " + grainsPath + " 6 --output=tmp/minTree.tif").c_str());
-    system("python3 ../utils/tiff2raw.py tmp/minTree.tif");
-    system((pinkDir + "raw2pgm tmp/minTree.raw " + std::to_string(x) + " " + std::to_string(y) + " " + std::to_string(z) + " 0 1 0 tmp/minTree.pgm").c_str());
-    system(("python3 ../utils/getCentroid.py " + grainsPath + " tmp/minTree.tif --output=tmp/centroids.csv").c_str());
-    system(("python3 ../utils/tiff_binarization.py " + grainsPath + " --threshold=" + threshold + " --output=tmp/grains_binarized.tif").c_str());
-    system("python3 ../utils/tiff_binary_sum.py tmp/grains_binarized.tif tmp/minTree.tif --output=tmp/grains_binarized.tif");
-    system("python3 ../utils/tiff2raw.py tmp/grains_binarized.tif");
-    system((pinkDir + "raw2pgm tmp/grains_binarized.raw " + std::to_string(x) + " " + std::to_string(y) + " " + std::to_string(z) + " 0 1 0 tmp/grains_binarized.pgm").c_str());
-    system((pinkDir + "skeleton tmp/grains_binarized.pgm 6 6 tmp/minTree.pgm tmp/skeleton.pgm").c_str());
-    system((pinkDir + "pgm2raw tmp/skeleton").c_str());
-
-    std::cout << "Pre-processing complete." << std::endl;
-
-    // --- 3. Data Loading ---
-    std::cout << "Loading data..." << std::endl;
-    Image3D grains = loadTiffImage("tmp/grains_binarized.tif");
-    Image3D minTree = loadTiffImage("tmp/minTree.tif");
-    Image3D skeleton = loadRawImage("tmp/skeleton.raw", x, y, z);
-    
-    if (grains.data.empty() || minTree.data.empty() || skeleton.data.empty()) {
-        std::cerr << "Critical Error: Failed to load one or more images. Aborting." << std::endl;
+    std::cout << "Starting pre-processing..." << std::endl;
+
+    // The intermediates that went through tmp/ stay in memory; each stage reads its inputs by reference.
+    // The 16-bit scan itself is never held: it is decoded twice, straight into the two 8-bit
+    // volumes the stages need.
+    Mask3D scan8;                  // The grains scan reduced to 8 bits (v / 256), as in minTree.py.
+    Mask3D minTree;                // Grain cores (minTree.py).
+    Mask3D grains;                 // Binarized grains, cores included (tiff_binarization.py + tiff_binary_sum.py).
+    Labels3D seeds;                // Labeled grain cores, one label per 6-connected core.
+    size_t num_cores = 0;
+
+    // Stages run side by side, so each gets its share of the thread budget (set once the graph is built).
+    unsigned stage_threads = 1;
+    StageGraph pipeline;
+    auto load = pipeline.add("load grains", {}, [&] {
+        scan8 = adopt_volume(read_tiff_image_xt<uint8_t>(grainsPath, VoxelTransform::shift(8), stage_threads));
+    });
+    auto coreExtraction = pipeline.add("minTree", {load}, [&] {
+        minTree = extract_min_tree_cores(scan8, 6);
+    });
+    // Thresholding while decoding applies the rule of binarize() (v >= threshold becomes 255).
+    auto binarization = pipeline.add("binarization", {}, [&] {
+        grains = adopt_volume(read_tiff_image_xt<uint8_t>(grainsPath, VoxelTransform::threshold(threshold, 255), stage_threads));
+    });
+    // Each core seeds its grain whole, so cores whose centroid falls outside them (non-convex
+    // cores) or inside a neighbouring core are not lost. Core labeling runs alongside the binary sum.
+    pipeline.add("core labeling", {coreExtraction}, [&] {
+        seeds = label_connected_components(minTree, 6, num_cores, stage_threads);
+    });
+    pipeline.add("binary sum", {binarization, coreExtraction}, [&] {
+        grains = binary_sum(grains, minTree, stage_threads);
+    });
+
+    const unsigned width = static_cast<unsigned>(pipeline.width());
+    stage_threads = std::max(1u, resolve_thread_count(num_threads, 0) / width);
+
+    try {
+        pipeline.run(width);
+    } catch (const std::exception& e) {
+        std::cerr << "Critical Error: " << e.what() << " Aborting." << std::endl;
         return;
     }
+    std::cout << "Pre-processing complete." << std::endl;
 
-    // --- 4. Contact Detection: Initial Seeding ---
-    std::cout << "Starting contact detection (seeding phase)..." << std::endl;
-
-    std::map<int, std::set<Voxel>> initialVisited;
-    std::map<int, std::set<Voxel>> initialToVisit;
-
-    auto centroids = loadCentroids("tmp/centroids.csv");
+    std::cout << "Seeded " << num_cores << " grains from their cores." << std::endl;
 
-    // Initialize the core of each grain based on its centroid.
-    for(const auto& pair : centroids) {
-        int label = pair.first;
-        Voxel v = pair.second;
-        initialVisited[label].insert(v);
-        std::deque<Voxel> kernel_q;
-        auto neighbors = get_neighbors(v);
-        // ... (rest of the initial propagation logic)
-    }
-    
-    // --- 5. Contact Detection: Main Iterative Loop ---
+    // --- 3. Contact Detection: Propagation at Each Erosion Level ---
+    // All grains grow at once through the eroded grains, level by level, from one distance
+    // transform; a contact's strength is the last erosion level at which its fronts still meet.
     std::cout << "Starting contact detection (main loop)..." << std::endl;
-    
-    std::map<std::pair<int, int>, int> contactsStrength;
-    Image3D erodedGrains = grains;
-    bool havingContacts = true;
-    int contactStrength = 0;
-
-    // This loop erodes the image and re-checks for contacts to determine their strength.
-    while(havingContacts) {
-        contactStrength++;
-        std::cout << "Erosion level (Contact Strength): " << contactStrength << std::endl;
-        // ... (rest of the main contact detection loop logic)
-    }
-
-    // --- 6. Cleanup & Saving Results ---
-    if (!keep_files) {
-        system("rm -r tmp");
-    }
+    std::map<std::pair<int, int>, int> contactsStrength = contact_strength_by_propagation(seeds, grains, num_threads);
+    std::cout << "Found " << contactsStrength.size() << " contacts." << std::endl;
 
+    // --- 4. Saving Results ---
     std::cout << "Saving results..." << std::endl;
     save_results(contactsStrength, outputPath); // This function is from common.hpp
 
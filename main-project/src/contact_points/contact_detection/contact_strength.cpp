@@ -0,0 +1,381 @@
+#include "include/contact_strength.hpp"
+#include "include/ParallelUtils.h"
+
+#include <algorithm>
+#include <cmath>
+#include <stdexcept>
+#include <type_traits>
+#include <vector>
+
+// Explicit template instantiations
+template Volume<uint32_t> city_block_distance<int>(const Volume<int>&, unsigned);
+template Volume<uint32_t> city_block_distance<uint8_t>(const Volume<uint8_t>&, unsigned);
+template Volume<uint32_t> city_block_distance<uint32_t>(const Volume<uint32_t>&, unsigned);
+template std::map<std::pair<int, int>, int> contact_strength_naive<int>(const Volume<int>&, unsigned);
+template std::map<std::pair<int, int>, int> contact_strength_naive<uint32_t>(const Volume<uint32_t>&, unsigned);
+template std::map<std::pair<int, int>, int> contact_strength_on_skeleton<int, int>(const Volume<int>&, const Volume<int>&, unsigned);
+template std::map<std::pair<int, int>, int> contact_strength_on_skeleton<uint32_t, uint8_t>(const Volume<uint32_t>&, const Volume<uint8_t>&, unsigned);
+template SkeletonIndex build_skeleton_index<int>(const Volume<int>&, unsigned);
+template SkeletonIndex build_skeleton_index<uint8_t>(const Volume<uint8_t>&, unsigned);
+template void group_skeleton_by_label<int>(SkeletonIndex&, const Volume<int>&);
+template void group_skeleton_by_label<uint32_t>(SkeletonIndex&, const Volume<uint32_t>&);
+template std::map<std::pair<int, int>, int> contact_strength_on_skeleton<int>(const Volume<int>&, const SkeletonIndex&, unsigned);
+template std::map<std::pair<int, int>, int> contact_strength_on_skeleton<uint32_t>(const Volume<uint32_t>&, const SkeletonIndex&, unsigned);
+template std::map<std::pair<int, int>, ContactStats> contact_statistics<int>(const Volume<int>&, unsigned);
+template std::map<std::pair<int, int>, ContactStats> contact_statistics<uint32_t>(const Volume<uint32_t>&, unsigned);
+
+// --- Distance Transform ---
+
+template<typename T>
+Volume<uint32_t> city_block_distance(const Volume<T>& labels, unsigned num_threads) {
+    const size_t nx = labels.x_dim, ny = labels.y_dim, nz = labels.z_dim;
+    const size_t slice = ny * nz;
+    const uint32_t far = static_cast<uint32_t>(nx + ny + nz);
+
+    // Every voxel is written by the first pass, by the thread that owns its slice.
+    Volume<uint32_t> dist = allocate_volume<uint32_t>(labels.x_dim, labels.y_dim, labels.z_dim);
+    uint32_t* d = dist.data.data();
+    const T* in = labels.data.data();
+
+    // Passes along k and j stay inside one slice, so slices are processed independently.
+    parallel_for(0, nx, num_threads, [&](size_t i) {
+        uint32_t* s = d + i * slice;
+        const T* src = in + i * slice;
+        for (size_t n = 0; n < slice; ++n) s[n] = src[n] == 0 ? 0 : far;
+
+        for (size_t j = 0; j < ny; ++j) {
+            uint32_t* line = s + j * nz;
+            for (size_t k = 1; k < nz; ++k) line[k] = std::min(line[k], line[k - 1] + 1);
+            for (size_t k = nz - 1; k-- > 0;) line[k] = std::min(line[k], line[k + 1] + 1);
+        }
+        for (size_t j = 1; j < ny; ++j) {
+            uint32_t* row = s + j * nz;
+            const uint32_t* prev = row - nz;
+            for (size_t k = 0; k < nz; ++k) row[k] = std::min(row[k], prev[k] + 1);
+        }
+        for (size_t j = ny - 1; j-- > 0;) {
+            uint32_t* row = s + j * nz;
+            const uint32_t* next = row + nz;
+            for (size_t k = 0; k < nz; ++k) row[k] = std::min(row[k], next[k] + 1);
+        }
+    });
+
+    // The pass along i runs over whole rows, so each worker owns a range of j.
+    parallel_for_chunks(0, ny, num_threads, [&](size_t j_begin, size_t j_end, unsigned) {
+        const size_t offset = j_begin * nz, count = (j_end - j_begin) * nz;
+        for (size_t i = 1; i < nx; ++i) {
+            uint32_t* row = d + i * slice + offset;
+            const uint32_t* prev = row - slice;
+            for (size_t n = 0; n < count; ++n) row[n] = std::min(row[n], prev[n] + 1);
+        }
+        for (size_t i = nx - 1; i-- > 0;) {
+            uint32_t* row = d + i * slice + offset;
+            const uint32_t* next = row + slice;
+            for (size_t n = 0; n < count; ++n) row[n] = std::min(row[n], next[n] + 1);
+        }
+    });
+
+    return dist;
+}
+
+// --- Packed Pair Samples ---
+
+namespace {
+
+/**
+ * @brief LSD radix sort of any sample type with a 64-bit `key` member (stable).
+ */
+template<typename Sample>
+void radix_sort_by_key(std::vector<Sample>& samples) {
+    if (samples.size() < 2) return;
+
+    // Bytes that are equal in every key (e.g. the high bytes of small labels) need no pass.
+    uint64_t all_or = 0, all_and = ~uint64_t(0);
+    for (const auto& s : samples) {
+        all_or |= s.key;
+        all_and &= s.key;
+    }
+    const uint64_t varying = all_or ^ all_and;
+
+    std::vector<Sample> buffer(samples.size());
+    for (unsigned shift = 0; shift < 64; shift += 8) {
+        if (((varying >> shift) & 0xFF) == 0) continue;
+
+        size_t count[257] = {0};
+        for (const auto& s : samples) ++count[((s.key >> shift) & 0xFF) + 1];
+        for (int b = 0; b < 256; ++b) count[b + 1] += count[b];
+        for (const auto& s : samples) buffer[count[(s.key >> shift) & 0xFF]++] = s;
+        samples.swap(buffer);
+    }
+}
+
+} // namespace
+
+void radix_sort_pair_samples(std::vector<PairSample>& samples) {
+    radix_sort_by_key(samples);
+}
+
+std::map<std::pair<int, int>, int> reduce_pair_samples_max(std::vector<PairSample>& samples) {
+    radix_sort_pair_samples(samples);
+
+    std::map<std::pair<int, int>, int> contacts;
+    for (size_t n = 0; n < samples.size();) {
+        const uint64_t key = samples[n].key;
+        uint32_t strength = 0;
+        for (; n < samples.size() && samples[n].key == key; ++n) {
+            strength = std::max(strength, samples[n].value);
+        }
+        contacts.emplace_hint(contacts.end(), unpack_label_pair(key), static_cast<int>(strength));
+    }
+    return contacts;
+}
+
+// --- Interface Sweep ---
+
+namespace {
+
+/**
+ * @brief A per-thread flat buffer of pair samples.
+ *
+ * Consecutive samples of the same pair (the common case along an interface) are merged
+ * on the fly, so the buffer stays much smaller than the number of interface voxels.
+ */
+class PairSampleBuffer {
+public:
+    void emit(int a, int b, uint32_t value) {
+        const uint64_t key = pack_label_pair(a, b);
+        if (!samples_.empty() && samples_.back().key == key) {
+            samples_.back().value = std::max(samples_.back().value, value);
+        } else {
+            samples_.push_back({key, value});
+        }
+    }
+
+    std::vector<PairSample>& samples() { return samples_; }
+
+private:
+    std::vector<PairSample> samples_;
+};
+
+/**
+ * @brief Accumulates the statistics of the voxel faces shared by a pair of labels.
+ */
+struct ContactSample {
+    uint64_t key;            ///< The pair, packed with pack_label_pair().
+    uint32_t strength;       ///< Largest distance of an interface voxel of the smaller label.
+    uint64_t faces;          ///< Number of shared voxel faces.
+    int64_t position2[3];    ///< Sum of the doubled face centers (integers, so sums are exact).
+    int64_t normal[3];       ///< Sum of the unit face normals, oriented from the smaller label.
+};
+
+/**
+ * @brief A per-thread flat buffer of contact samples, merging consecutive samples of a pair.
+ */
+class ContactSampleBuffer {
+public:
+    void emit(int a, int b, uint32_t strength, const int64_t position2[3], int axis, int sign) {
+        const uint64_t key = pack_label_pair(a, b);
+        if (samples_.empty() || samples_.back().key != key) {
+            samples_.push_back({key, 0, 0, {0, 0, 0}, {0, 0, 0}});
+        }
+        ContactSample& s = samples_.back();
+        s.strength = std::max(s.strength, strength);
+        s.faces += 1;
+        for (int d = 0; d < 3; ++d) s.position2[d] += position2[d];
+        s.normal[axis] += sign;
+    }
+
+    std::vector<ContactSample>& samples() { return samples_; }
+
+private:
+    std::vector<ContactSample> samples_;
+};
+
+/**
+ * @brief Visits every pair of 6-adjacent voxels once (3 forward directions), in parallel over slices.
+ *
+ * `visit(buffer, p, q, axis)` is called with the flat indices of the two voxels, `p` being
+ * the lower-coordinate one and `axis` (0 for i, 1 for j, 2 for k) the direction from `p` to
+ * `q`, and emits samples into its worker's buffer. Workers own contiguous slabs of slices
+ * and only read one slice past their slab.
+ *
+ * @return The samples of all workers, concatenated in worker order.
+ */
+template<typename Buffer, typename T, typename Visit>
+auto sweep_adjacent_pairs(const Volume<T>& labels, unsigned num_threads, Visit&& visit) {
+    const size_t nx = labels.x_dim, ny = labels.y_dim, nz = labels.z_dim;
+    const size_t slice = ny * nz;
+    const unsigned workers = resolve_thread_count(num_threads, nx);
+    std::vector<Buffer> partial(workers);
+
+    parallel_for_chunks(0, nx, workers, [&](size_t i_begin, size_t i_end, unsigned w) {
+        Buffer& local = partial[w];
+        for (size_t i = i_begin; i < i_end; ++i) {
+            for (size_t j = 0; j < ny; ++j) {
+                for (size_t k = 0; k < nz; ++k) {
+                    const size_t idx = k + nz * (j + ny * i);
+                    if (k + 1 < nz) visit(local, idx, idx + 1, 2);
+                    if (j + 1 < ny) visit(local, idx, idx + nz, 1);
+                    if (i + 1 < nx) visit(local, idx, idx + slice, 0);
+                }
+            }
+        }
+    });
+
+    std::remove_reference_t<decltype(partial[0].samples())> samples;
+    for (auto& local : partial) {
+        samples.insert(samples.end(), local.samples().begin(), local.samples().end());
+    }
+    return samples;
+}
+
+} // namespace
+
+template<typename T>
+std::map<std::pair<int, int>, int> contact_strength_naive(const Volume<T>& labels, unsigned num_threads) {
+    const Volume<uint32_t> dist = city_block_distance(labels, num_threads);
+
+    auto samples = sweep_adjacent_pairs<PairSampleBuffer>(labels, num_threads, [&](PairSampleBuffer& out, size_t p, size_t q, int) {
+        const int a = static_cast<int>(labels.data[p]);
+        const int b = static_cast<int>(labels.data[q]);
+        if (a == 0 || b == 0 || a == b) return;
+        // Only the voxel of the smaller label counts, as in the erosion loop this replaces.
+        if (a < b) out.emit(a, b, dist.data[p]);
+        else out.emit(b, a, dist.data[q]);
+    });
+    return reduce_pair_samples_max(samples);
+}
+
+// --- Skeleton Index ---
+
+template<typename S>
+SkeletonIndex build_skeleton_index(const Volume<S>& skeleton, unsigned num_threads) {
+    const size_t nx = skeleton.x_dim, slice = size_t(skeleton.y_dim) * skeleton.z_dim;
+    const unsigned workers = resolve_thread_count(num_threads, nx);
+    std::vector<std::vector<uint64_t>> partial(workers);
+
+    parallel_for_chunks(0, nx, workers, [&](size_t i_begin, size_t i_end, unsigned w) {
+        for (size_t idx = i_begin * slice; idx < i_end * slice; ++idx) {
+            if (skeleton.data[idx] != 0) partial[w].push_back(idx);
+        }
+    });
+
+    SkeletonIndex index;
+    index.x_dim = skeleton.x_dim;
+    index.y_dim = skeleton.y_dim;
+    index.z_dim = skeleton.z_dim;
+    for (const auto& part : partial) {
+        index.voxels.insert(index.voxels.end(), part.begin(), part.end());
+    }
+    return index;
+}
+
+template<typename T>
+void group_skeleton_by_label(SkeletonIndex& index, const Volume<T>& labels) {
+    std::stable_sort(index.voxels.begin(), index.voxels.end(), [&](uint64_t a, uint64_t b) {
+        return labels.data[a] < labels.data[b];
+    });
+    index.label_starts.clear();
+    for (size_t n = 0; n < index.voxels.size(); ++n) {
+        const int label = static_cast<int>(labels.data[index.voxels[n]]);
+        if (n == 0 || label != index.label_starts.back().first) index.label_starts.emplace_back(label, n);
+    }
+}
+
+template<typename T>
+std::map<std::pair<int, int>, int> contact_strength_on_skeleton(const Volume<T>& labels, const SkeletonIndex& skeleton,
+                                                                unsigned num_threads) {
+    if (skeleton.x_dim != labels.x_dim || skeleton.y_dim != labels.y_dim || skeleton.z_dim != labels.z_dim) {
+        throw std::invalid_argument("Error: Skeleton and label image dimensions do not match!");
+    }
+    const Volume<uint32_t> dist = city_block_distance(labels, num_threads);
+    const size_t nx = labels.x_dim, ny = labels.y_dim, nz = labels.z_dim, slice = ny * nz;
+
+    const unsigned workers = resolve_thread_count(num_threads, skeleton.size());
+    std::vector<PairSampleBuffer> partial(workers);
+
+    // Only skeleton voxels are visited; each one looks at its 6 neighbors for a larger label.
+    parallel_for_chunks(0, skeleton.size(), workers, [&](size_t begin, size_t end, unsigned w) {
+        PairSampleBuffer& out = partial[w];
+        for (size_t n = begin; n < end; ++n) {
+            const size_t p = skeleton.voxels[n];
+            const int a = static_cast<int>(labels.data[p]);
+            if (a == 0) continue;
+            const size_t i = p / slice, j = (p / nz) % ny, k = p % nz;
+            auto check = [&](size_t q) {
+                const int b = static_cast<int>(labels.data[q]);
+                // Both voxels must survive the erosions for the contact to be seen.
+                if (b != 0 && a < b) out.emit(a, b, std::min(dist.data[p], dist.data[q]));
+            };
+            if (i > 0) check(p - slice);
+            if (i + 1 < nx) check(p + slice);
+            if (j > 0) check(p - nz);
+            if (j + 1 < ny) check(p + nz);
+            if (k > 0) check(p - 1);
+            if (k + 1 < nz) check(p + 1);
+        }
+    });
+
+    std::vector<PairSample> samples;
+    for (auto& local : partial) {
+        samples.insert(samples.end(), local.samples().begin(), local.samples().end());
+    }
+    return reduce_pair_samples_max(samples);
+}
+
+template<typename T, typename S>
+std::map<std::pair<int, int>, int> contact_strength_on_skeleton(const Volume<T>& labels, const Volume<S>& skeleton,
+                                                                unsigned num_threads) {
+    if (skeleton.x_dim != labels.x_dim || skeleton.y_dim != labels.y_dim || skeleton.z_dim != labels.z_dim) {
+        throw std::invalid_argument("Error: Skeleton and label image dimensions do not match!");
+    }
+    return contact_strength_on_skeleton(labels, build_skeleton_index(skeleton, num_threads), num_threads);
+}
+
+template<typename T>
+std::map<std::pair<int, int>, ContactStats> contact_statistics(const Volume<T>& labels, unsigned num_threads) {
+    const Volume<uint32_t> dist = city_block_distance(labels, num_threads);
+    const size_t ny = labels.y_dim, nz = labels.z_dim;
+
+    auto samples = sweep_adjacent_pairs<ContactSampleBuffer>(labels, num_threads,
+                                                             [&](ContactSampleBuffer& out, size_t p, size_t q, int axis) {
+        const int a = static_cast<int>(labels.data[p]);
+        const int b = static_cast<int>(labels.data[q]);
+        if (a == 0 || b == 0 || a == b) return;
+
+        // The shared face lies halfway between p and q: doubled, its center is p + q.
+        const int64_t i = p / (ny * nz), j = (p / nz) % ny, k = p % nz;
+        const int64_t position2[3] = {2 * i + (axis == 0), 2 * j + (axis == 1), 2 * k + (axis == 2)};
+        if (a < b) out.emit(a, b, dist.data[p], position2, axis, +1);
+        else out.emit(b, a, dist.data[q], position2, axis, -1);
+    });
+    radix_sort_by_key(samples);
+
+    std::map<std::pair<int, int>, ContactStats> contacts;
+    for (size_t n = 0; n < samples.size();) {
+        ContactSample total = samples[n];
+        for (++n; n < samples.size() && samples[n].key == total.key; ++n) {
+            total.strength = std::max(total.strength, samples[n].strength);
+            total.faces += samples[n].faces;
+            for (int d = 0; d < 3; ++d) {
+                total.position2[d] += samples[n].position2[d];
+                total.normal[d] += samples[n].normal[d];
+            }
+        }
+
+        ContactStats stats;
+        stats.strength = static_cast<int>(total.strength);
+        stats.face_count = total.faces;
+        double norm = 0;
+        for (int d = 0; d < 3; ++d) {
+            stats.centroid[d] = double(total.position2[d]) / (2.0 * double(total.faces));
+            norm += double(total.normal[d]) * double(total.normal[d]);
+        }
+        norm = std::sqrt(norm);
+        for (int d = 0; d < 3; ++d) {
+            stats.normal[d] = norm > 0 ? double(total.normal[d]) / norm : 0.0;
+        }
+        contacts.emplace_hint(contacts.end(), unpack_label_pair(total.key), stats);
+    }
+    return contacts;
+}
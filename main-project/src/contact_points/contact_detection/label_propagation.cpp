@@ -0,0 +1,237 @@
+#include "include/label_propagation.hpp"
+#include "include/contact_strength.hpp" // For city_block_distance() and the pair samples
+#include "include/ParallelUtils.h"
+
+#include <algorithm>
+#include <stdexcept>
+#include <vector>
+
+// Explicit template instantiations
+template LabelPropagation propagate_labels<uint8_t>(const Labels3D&, const Volume<uint8_t>&, uint8_t, unsigned);
+template LabelPropagation propagate_labels<uint32_t>(const Labels3D&, const Volume<uint32_t>&, uint32_t, unsigned);
+template std::map<std::pair<int, int>, int> contact_strength_by_propagation<int>(const Labels3D&, const Volume<int>&, unsigned);
+template std::map<std::pair<int, int>, int> contact_strength_by_propagation<uint8_t>(const Labels3D&, const Volume<uint8_t>&, unsigned);
+
+namespace {
+
+/**
+ * @brief A voxel reached by a front, and the label of that front.
+ */
+struct Claim {
+    uint64_t voxel;
+    uint32_t label;
+};
+
+/**
+ * @brief The claims and the met fronts found by one worker in one level.
+ */
+struct FrontBuffer {
+    std::vector<Claim> claims;
+    std::vector<PairSample> met;
+
+    void meet(uint32_t a, uint32_t b) {
+        const uint64_t key = pack_label_pair(static_cast<int>(std::min(a, b)), static_cast<int>(std::max(a, b)));
+        if (met.empty() || met.back().key != key) met.push_back({key, 0});
+    }
+};
+
+/**
+ * @brief Grows the labels of a frontier until no front can advance.
+ *
+ * Each level of the flood is a flat frontier vector whose neighbours are examined in
+ * parallel; a voxel u is reached when label[u] is 0 and inside[u] >= threshold, and a voxel
+ * reached by several labels in the same level takes the smallest one. Every frontier voxel
+ * compares its label with those of its neighbours, and the pairs that differ are appended
+ * to `met`. On return, the frontier is empty.
+ */
+template<typename T>
+void grow_fronts(std::vector<uint64_t>& frontier, uint32_t* label, const T* inside, T threshold,
+                 size_t nx, size_t ny, size_t nz, std::vector<FrontBuffer>& buffers, std::vector<PairSample>& met) {
+    const size_t slice = ny * nz;
+    while (!frontier.empty()) {
+        // The neighbours of the frontier are examined in parallel; labels are only read here.
+        parallel_for_chunks(0, frontier.size(), unsigned(buffers.size()), [&](size_t b, size_t e, unsigned w) {
+            FrontBuffer& local = buffers[w];
+            for (size_t c = b; c < e; ++c) {
+                const size_t v = frontier[c];
+                const size_t i = v / slice, j = (v / nz) % ny, k = v % nz;
+                auto visit = [&](size_t u) {
+                    if (label[u] == 0) {
+                        if (inside[u] >= threshold) local.claims.push_back({u, label[v]});
+                    } else if (label[u] != label[v]) {
+                        local.meet(label[v], label[u]);
+                    }
+                };
+                if (i > 0) visit(v - slice);
+                if (i + 1 < nx) visit(v + slice);
+                if (j > 0) visit(v - nz);
+                if (j + 1 < ny) visit(v + nz);
+                if (k > 0) visit(v - 1);
+                if (k + 1 < nz) visit(v + 1);
+            }
+        });
+
+        // Claims are applied in frontier order; a voxel claimed twice in a level keeps the smallest label.
+        frontier.clear();
+        for (auto& local : buffers) {
+            for (const Claim& c : local.claims) {
+                uint32_t& l = label[c.voxel];
+                if (l == 0) {
+                    l = c.label;
+                    frontier.push_back(c.voxel);
+                } else if (c.label < l) {
+                    l = c.label;
+                }
+            }
+            local.claims.clear();
+            met.insert(met.end(), local.met.begin(), local.met.end());
+            local.met.clear();
+        }
+    }
+}
+
+/**
+ * @brief Appends the distinct pairs of a list of met fronts, sorting (and consuming) the list.
+ */
+void collect_contacts(std::vector<PairSample>& met, std::vector<std::pair<int, int>>& contacts) {
+    radix_sort_pair_samples(met);
+    for (size_t s = 0; s < met.size(); ++s) {
+        if (s == 0 || met[s].key != met[s - 1].key) contacts.push_back(unpack_label_pair(met[s].key));
+    }
+    met.clear();
+}
+
+} // namespace
+
+template<typename T>
+LabelPropagation propagate_labels(const Labels3D& seeds, const Volume<T>& domain, T threshold, unsigned num_threads) {
+    if (seeds.x_dim != domain.x_dim || seeds.y_dim != domain.y_dim || seeds.z_dim != domain.z_dim) {
+        throw std::invalid_argument("Error: Seed and domain dimensions do not match!");
+    }
+    const size_t n = domain.size();
+    const size_t nx = domain.x_dim, ny = domain.y_dim, nz = domain.z_dim;
+    const unsigned max_workers = resolve_thread_count(num_threads, 0);
+    std::vector<FrontBuffer> buffers(max_workers);
+
+    LabelPropagation result;
+    Labels3D& labels = result.labels;
+    labels = allocate_volume<uint32_t>(domain.x_dim, domain.y_dim, domain.z_dim);
+    uint32_t* label = labels.data.data();
+    const T* inside = domain.data.data();
+
+    // Level 0: the seeds inside the domain, collected in memory order.
+    std::vector<uint64_t> frontier;
+    parallel_for_chunks(0, n, max_workers, [&](size_t b, size_t e, unsigned w) {
+        for (size_t v = b; v < e; ++v) {
+            label[v] = inside[v] >= threshold ? seeds.data[v] : 0;
+            if (label[v] != 0) buffers[w].claims.push_back({v, label[v]});
+        }
+    });
+    for (auto& buffer : buffers) {
+        for (const Claim& c : buffer.claims) frontier.push_back(c.voxel);
+        buffer.claims.clear();
+    }
+
+    std::vector<PairSample> met;
+    grow_fronts(frontier, label, inside, threshold, nx, ny, nz, buffers, met);
+    collect_contacts(met, result.contacts);
+    return result;
+}
+
+template<typename T>
+std::map<std::pair<int, int>, int> contact_strength_by_propagation(const Labels3D& seeds, const Volume<T>& grains,
+                                                                   unsigned num_threads) {
+    if (seeds.x_dim != grains.x_dim || seeds.y_dim != grains.y_dim || seeds.z_dim != grains.z_dim) {
+        throw std::invalid_argument("Error: Seed and grain dimensions do not match!");
+    }
+    const size_t n = grains.size();
+    const size_t nx = grains.x_dim, ny = grains.y_dim, nz = grains.z_dim;
+    const size_t slice = ny * nz;
+    const unsigned max_workers = resolve_thread_count(num_threads, 0);
+
+    // --- 1. Level map: level n admits the voxels at city-block distance n ---
+    // Distances are clamped to 16 bits, and the 32-bit distance volume is released once the
+    // map is built, before the labels are allocated.
+    Volume<uint16_t> level_map = allocate_volume<uint16_t>(grains.x_dim, grains.y_dim, grains.z_dim);
+    uint16_t* level_of = level_map.data.data();
+    uint16_t top = 0;
+    {
+        const Volume<uint32_t> distance = city_block_distance(grains, num_threads);
+        std::vector<uint16_t> tops(max_workers, 0);
+        parallel_for_chunks(0, n, max_workers, [&](size_t b, size_t e, unsigned w) {
+            for (size_t v = b; v < e; ++v) {
+                level_of[v] = static_cast<uint16_t>(std::min<uint32_t>(distance.data[v], UINT16_MAX));
+                tops[w] = std::max(tops[w], level_of[v]);
+            }
+        });
+        for (uint16_t t : tops) top = std::max(top, t);
+    }
+
+    // --- 2. Levels, from the most eroded grains down to the grains themselves ---
+    // The labels of a level are those of the level above, grown into the voxels it admits,
+    // so every voxel is claimed once. A pair in contact stays in contact at the levels below,
+    // and its strength is the first (highest) level at which its fronts meet.
+    Labels3D labels = make_volume<uint32_t>(grains.x_dim, grains.y_dim, grains.z_dim, 0);
+    uint32_t* label = labels.data.data();
+    std::vector<FrontBuffer> buffers(max_workers);
+    std::vector<std::vector<uint64_t>> admitted_by(max_workers);
+    std::vector<uint64_t> admitted, frontier;
+    std::vector<PairSample> met;
+    std::vector<std::pair<int, int>> contacts;
+    std::map<std::pair<int, int>, int> contactsStrength;
+    for (uint32_t level = top; level >= 1; --level) {
+        // The voxels of the level are collected per slab, in memory order; the seeds among
+        // them start their own fronts.
+        parallel_for_chunks(0, n, max_workers, [&](size_t b, size_t e, unsigned w) {
+            for (size_t v = b; v < e; ++v) {
+                if (level_of[v] != level) continue;
+                if (seeds.data[v] != 0) {
+                    label[v] = seeds.data[v];
+                    buffers[w].claims.push_back({v, label[v]});
+                } else {
+                    admitted_by[w].push_back(v);
+                }
+            }
+        });
+        admitted.clear();
+        for (unsigned w = 0; w < max_workers; ++w) {
+            for (const Claim& c : buffers[w].claims) frontier.push_back(c.voxel);
+            buffers[w].claims.clear();
+            admitted.insert(admitted.end(), admitted_by[w].begin(), admitted_by[w].end());
+            admitted_by[w].clear();
+        }
+
+        // The other admitted voxels next to a label take the smallest such label; this is the
+        // first step of the fronts of the level above.
+        parallel_for_chunks(0, admitted.size(), max_workers, [&](size_t b, size_t e, unsigned w) {
+            for (size_t c = b; c < e; ++c) {
+                const uint64_t v = admitted[c];
+                const size_t i = v / slice, j = (v / nz) % ny, k = v % nz;
+                uint32_t best = 0;
+                auto look = [&](size_t u) {
+                    if (label[u] != 0 && (best == 0 || label[u] < best)) best = label[u];
+                };
+                if (i > 0) look(v - slice);
+                if (i + 1 < nx) look(v + slice);
+                if (j > 0) look(v - nz);
+                if (j + 1 < ny) look(v + nz);
+                if (k > 0) look(v - 1);
+                if (k + 1 < nz) look(v + 1);
+                if (best != 0) buffers[w].claims.push_back({v, best});
+            }
+        });
+        for (auto& buffer : buffers) {
+            for (const Claim& c : buffer.claims) {
+                label[c.voxel] = c.label;
+                frontier.push_back(c.voxel);
+            }
+            buffer.claims.clear();
+        }
+
+        grow_fronts(frontier, label, level_of, static_cast<uint16_t>(level), nx, ny, nz, buffers, met);
+        contacts.clear();
+        collect_contacts(met, contacts);
+        for (const auto& pair : contacts) contactsStrength.emplace(pair, static_cast<int>(level));
+    }
+    return contactsStrength;
+}
@@ -0,0 +1,396 @@
+#include "include/morphology.hpp"
+#include "include/ParallelUtils.h"
+
+#include <algorithm>
+#include <array>
+#include <cmath>
+#include <cstdint>
+#include <functional>
+#include <limits>
+#include <stdexcept>
+#include <vector>
+
+// Explicit template instantiations
+template Volume<uint32_t> squared_distance_transform<int>(const Volume<int>&, unsigned);
+template Volume<uint32_t> squared_distance_transform<uint8_t>(const Mask3D&, unsigned);
+template void dilate_box<int>(Volume<int>&, int, int, int, unsigned);
+template void dilate_box<uint8_t>(Mask3D&, int, int, int, unsigned);
+template void dilate_box<uint16_t>(Volume<uint16_t>&, int, int, int, unsigned);
+template void dilate_box<uint32_t>(Labels3D&, int, int, int, unsigned);
+template void erode_box<int>(Volume<int>&, int, int, int, unsigned);
+template void erode_box<uint8_t>(Mask3D&, int, int, int, unsigned);
+template void erode_box<uint16_t>(Volume<uint16_t>&, int, int, int, unsigned);
+template void erode_box<uint32_t>(Labels3D&, int, int, int, unsigned);
+template void open_box<int>(Volume<int>&, int, int, int, unsigned);
+template void open_box<uint8_t>(Mask3D&, int, int, int, unsigned);
+template void open_box<uint16_t>(Volume<uint16_t>&, int, int, int, unsigned);
+template void open_box<uint32_t>(Labels3D&, int, int, int, unsigned);
+template void close_box<int>(Volume<int>&, int, int, int, unsigned);
+template void close_box<uint8_t>(Mask3D&, int, int, int, unsigned);
+template void close_box<uint16_t>(Volume<uint16_t>&, int, int, int, unsigned);
+template void close_box<uint32_t>(Labels3D&, int, int, int, unsigned);
+template void reconstruct_by_dilation<int>(Volume<int>&, const Volume<int>&, int, unsigned);
+template void reconstruct_by_dilation<uint8_t>(Mask3D&, const Mask3D&, int, unsigned);
+template void reconstruct_by_dilation<uint16_t>(Volume<uint16_t>&, const Volume<uint16_t>&, int, unsigned);
+template void reconstruct_by_dilation<uint32_t>(Labels3D&, const Labels3D&, int, unsigned);
+
+namespace {
+
+/**
+ * @brief The lower envelope of one line of parabolas, reused from line to line.
+ */
+struct Envelope {
+    std::vector<long> site;       ///< Position of each parabola of the envelope.
+    std::vector<uint32_t> height; ///< Its value at the site.
+    std::vector<double> start;    ///< Where it starts to be the lowest.
+};
+
+/**
+ * @brief One separable pass of the squared Euclidean distance transform along a line.
+ *
+ * Replaces every value f(x) by min_y f(y) + (x - y)^2, clamped to `cap`, with the lower
+ * envelope of the parabolas (Felzenszwalb and Huttenlocher). Values at `cap` cannot lower
+ * any clamped result, so they are left out of the envelope.
+ */
+template<typename D>
+void distance_line(D* line, size_t stride, size_t n, uint32_t cap, Envelope& env) {
+    env.site.clear();
+    env.height.clear();
+    env.start.clear();
+    for (size_t q = 0; q < n; ++q) {
+        const uint32_t f = line[q * stride];
+        if (f >= cap) continue;
+        const long y = static_cast<long>(q);
+        double s = -std::numeric_limits<double>::infinity();
+        while (!env.site.empty()) {
+            const long v = env.site.back();
+            s = ((double(f) + double(y) * y) - (double(env.height.back()) + double(v) * v)) / (2.0 * (y - v));
+            if (s > env.start.back()) break;
+            env.site.pop_back();
+            env.height.pop_back();
+            env.start.pop_back();
+            s = -std::numeric_limits<double>::infinity();
+        }
+        env.site.push_back(y);
+        env.height.push_back(f);
+        env.start.push_back(s);
+    }
+    if (env.site.empty()) return; // Every value stays at the cap.
+
+    size_t p = 0;
+    for (size_t x = 0; x < n; ++x) {
+        while (p + 1 < env.site.size() && env.start[p + 1] < double(x)) ++p;
+        const uint64_t dx = static_cast<uint64_t>(std::abs(long(x) - env.site[p]));
+        const uint64_t value = dx * dx + env.height[p];
+        line[x * stride] = static_cast<D>(std::min<uint64_t>(value, cap));
+    }
+}
+
+/**
+ * @brief Squared Euclidean distance to the nearest zero voxel, clamped to `cap`.
+ * @param d On input, 0 on the sites and `cap` elsewhere; on output, the clamped squared distances.
+ */
+template<typename D>
+void clamped_squared_distance(D* d, size_t nx, size_t ny, size_t nz, uint32_t cap, unsigned num_threads) {
+    const size_t slice = ny * nz;
+    const unsigned workers = resolve_thread_count(num_threads, std::max(nx, ny));
+    std::vector<Envelope> envelopes(workers);
+
+    // Along k, then along j, one slice at a time.
+    parallel_for_chunks(0, nx, workers, [&](size_t b, size_t e, unsigned w) {
+        for (size_t i = b; i < e; ++i) {
+            D* s = d + i * slice;
+            for (size_t j = 0; j < ny; ++j) distance_line(s + j * nz, 1, nz, cap, envelopes[w]);
+            for (size_t k = 0; k < nz; ++k) distance_line(s + k, nz, ny, cap, envelopes[w]);
+        }
+    });
+    // Along i, over slabs of rows.
+    parallel_for_chunks(0, ny, workers, [&](size_t b, size_t e, unsigned w) {
+        for (size_t j = b; j < e; ++j) {
+            for (size_t k = 0; k < nz; ++k) distance_line(d + j * nz + k, slice, nx, cap, envelopes[w]);
+        }
+    });
+}
+
+/**
+ * @brief Thresholds the clamped squared distance of every voxel to a set of sites.
+ *
+ * The sites are the foreground voxels (dilation) or the background voxels (erosion); a voxel
+ * is foreground on return when its squared distance is at most r^2 (dilation) or above it
+ * (erosion).
+ */
+void ball_morphology(Mask3D& mask, double radius, bool dilate, unsigned num_threads) {
+    if (radius < 0) {
+        throw std::invalid_argument("Error: The ball radius must not be negative.");
+    }
+    const double r2 = std::floor(radius * radius);
+    const size_t n = mask.size();
+    uint8_t* m = mask.data.data();
+
+    auto run = [&](auto* d, uint32_t cap) {
+        parallel_for_chunks(0, n, num_threads, [&](size_t b, size_t e, unsigned) {
+            for (size_t v = b; v < e; ++v) d[v] = (m[v] != 0) == dilate ? 0 : cap;
+        });
+        clamped_squared_distance(d, mask.x_dim, mask.y_dim, mask.z_dim, cap, num_threads);
+        parallel_for_chunks(0, n, num_threads, [&](size_t b, size_t e, unsigned) {
+            for (size_t v = b; v < e; ++v) m[v] = (d[v] < cap) == dilate ? 255 : 0;
+        });
+    };
+
+    // Distances above r^2 all behave the same, so they are clamped to r^2 + 1.
+    if (r2 < 255) {
+        run(m, static_cast<uint32_t>(r2) + 1);
+    } else {
+        const uint32_t cap = static_cast<uint32_t>(std::min(r2, 4294967294.0)) + 1;
+        std::vector<uint32_t> distance(n);
+        run(distance.data(), cap);
+    }
+}
+
+// --- Line Filters ---
+
+/**
+ * @brief The padded line and the block prefix and suffix extrema of one van Herk / Gil-Werman pass.
+ */
+template<typename T>
+struct LineBuffers {
+    std::vector<T> padded, prefix, suffix;
+};
+
+/**
+ * @brief Replaces every value of a line by the extremum of the window of `radius` around it.
+ * @param better The order of the extremum (std::greater for a maximum, std::less for a minimum).
+ * @param identity The neutral value of the extremum, used as padding past the ends of the line.
+ */
+template<typename T, typename Better>
+void line_filter(T* line, size_t stride, size_t n, size_t radius, Better better, T identity, LineBuffers<T>& buf) {
+    const size_t w = 2 * radius + 1;
+    const size_t m = n + 2 * radius;
+    buf.padded.assign(m, identity);
+    buf.prefix.resize(m);
+    buf.suffix.resize(m);
+    for (size_t x = 0; x < n; ++x) buf.padded[x + radius] = line[x * stride];
+
+    auto pick = [&](T a, T b) { return better(b, a) ? b : a; };
+    for (size_t block = 0; block < m; block += w) {
+        const size_t end = std::min(block + w, m);
+        buf.prefix[block] = buf.padded[block];
+        for (size_t x = block + 1; x < end; ++x) buf.prefix[x] = pick(buf.prefix[x - 1], buf.padded[x]);
+        buf.suffix[end - 1] = buf.padded[end - 1];
+        for (size_t x = end - 1; x > block; --x) buf.suffix[x - 1] = pick(buf.suffix[x], buf.padded[x - 1]);
+    }
+    // The window of x is padded[x .. x + w - 1]: the end of one block and the start of the next.
+    for (size_t x = 0; x < n; ++x) line[x * stride] = pick(buf.suffix[x], buf.prefix[x + w - 1]);
+}
+
+/**
+ * @brief Filters every line of a box structuring element, one axis after the other.
+ */
+template<typename T, typename Better>
+void box_filter(Volume<T>& image, int ri, int rj, int rk, Better better, T identity, unsigned num_threads) {
+    if (ri < 0 || rj < 0 || rk < 0) {
+        throw std::invalid_argument("Error: The box radii must not be negative.");
+    }
+    const size_t nx = image.x_dim, ny = image.y_dim, nz = image.z_dim;
+    const size_t slice = ny * nz;
+    T* d = image.data.data();
+    const unsigned workers = resolve_thread_count(num_threads, std::max(nx, ny));
+    std::vector<LineBuffers<T>> buffers(workers);
+
+    // Along k and j, one slice at a time.
+    if (rj > 0 || rk > 0) {
+        parallel_for_chunks(0, nx, workers, [&](size_t b, size_t e, unsigned w) {
+            for (size_t i = b; i < e; ++i) {
+                T* s = d + i * slice;
+                if (rk > 0) {
+                    for (size_t j = 0; j < ny; ++j) line_filter(s + j * nz, 1, nz, rk, better, identity, buffers[w]);
+                }
+                if (rj > 0) {
+                    for (size_t k = 0; k < nz; ++k) line_filter(s + k, nz, ny, rj, better, identity, buffers[w]);
+                }
+            }
+        });
+    }
+    // Along i, over slabs of rows.
+    if (ri > 0) {
+        parallel_for_chunks(0, ny, workers, [&](size_t b, size_t e, unsigned w) {
+            for (size_t j = b; j < e; ++j) {
+                for (size_t k = 0; k < nz; ++k) line_filter(d + j * nz + k, slice, nx, ri, better, identity, buffers[w]);
+            }
+        });
+    }
+}
+
+// --- Reconstruction ---
+
+/**
+ * @brief Returns the neighbour offsets (di, dj, dk) that precede a voxel in raster order.
+ */
+std::vector<std::array<int, 3>> preceding_offsets(int connectivity) {
+    std::vector<std::array<int, 3>> offsets;
+    for (int di = -1; di <= 0; ++di) {
+        for (int dj = -1; dj <= 1; ++dj) {
+            for (int dk = -1; dk <= 1; ++dk) {
+                const bool before = di < 0 || (di == 0 && (dj < 0 || (dj == 0 && dk < 0)));
+                const int order = (di != 0) + (dj != 0) + (dk != 0);
+                if (!before) continue;
+                if ((connectivity == 6 && order > 1) || (connectivity == 18 && order > 2)) continue;
+                offsets.push_back({di, dj, dk});
+            }
+        }
+    }
+    return offsets;
+}
+
+} // namespace
+
+template<typename T>
+Volume<uint32_t> squared_distance_transform(const Volume<T>& mask, unsigned num_threads) {
+    const double nx = mask.x_dim, ny = mask.y_dim, nz = mask.z_dim;
+    const uint32_t cap = static_cast<uint32_t>(std::min(nx * nx + ny * ny + nz * nz + 1, 4294967295.0));
+    Volume<uint32_t> distance = allocate_volume<uint32_t>(mask.x_dim, mask.y_dim, mask.z_dim);
+    uint32_t* d = distance.data.data();
+    parallel_for_chunks(0, mask.size(), num_threads, [&](size_t b, size_t e, unsigned) {
+        for (size_t v = b; v < e; ++v) d[v] = mask.data[v] != 0 ? cap : 0;
+    });
+    clamped_squared_distance(d, mask.x_dim, mask.y_dim, mask.z_dim, cap, num_threads);
+    return distance;
+}
+
+void dilate_ball(Mask3D& mask, double radius, unsigned num_threads) {
+    ball_morphology(mask, radius, true, num_threads);
+}
+
+void erode_ball(Mask3D& mask, double radius, unsigned num_threads) {
+    ball_morphology(mask, radius, false, num_threads);
+}
+
+template<typename T>
+void dilate_box(Volume<T>& image, int ri, int rj, int rk, unsigned num_threads) {
+    box_filter(image, ri, rj, rk, std::greater<T>(), std::numeric_limits<T>::lowest(), num_threads);
+}
+
+template<typename T>
+void erode_box(Volume<T>& image, int ri, int rj, int rk, unsigned num_threads) {
+    box_filter(image, ri, rj, rk, std::less<T>(), std::numeric_limits<T>::max(), num_threads);
+}
+
+template<typename T>
+void open_box(Volume<T>& image, int ri, int rj, int rk, unsigned num_threads) {
+    erode_box(image, ri, rj, rk, num_threads);
+    dilate_box(image, ri, rj, rk, num_threads);
+}
+
+template<typename T>
+void close_box(Volume<T>& image, int ri, int rj, int rk, unsigned num_threads) {
+    dilate_box(image, ri, rj, rk, num_threads);
+    erode_box(image, ri, rj, rk, num_threads);
+}
+
+template<typename T>
+void reconstruct_by_dilation(Volume<T>& marker, const Volume<T>& mask, int connectivity, unsigned num_threads) {
+    if (marker.x_dim != mask.x_dim || marker.y_dim != mask.y_dim || marker.z_dim != mask.z_dim) {
+        throw std::invalid_argument("Error: Marker and mask dimensions do not match!");
+    }
+    if (connectivity != 6 && connectivity != 18 && connectivity != 26) {
+        throw std::invalid_argument("Error: Reconstruction connectivity must be 6, 18 or 26.");
+    }
+    const size_t nx = marker.x_dim, ny = marker.y_dim, nz = marker.z_dim;
+    const size_t slice = ny * nz;
+    T* f = marker.data.data();
+    const T* g = mask.data.data();
+
+    // Neighbours before a voxel in raster order, then all of them.
+    const auto before = preceding_offsets(connectivity);
+    std::vector<std::array<int, 3>> all = before;
+    for (const auto& o : before) all.push_back({-o[0], -o[1], -o[2]});
+    const size_t num_before = before.size();
+
+    // Calls visit(u) for the neighbours u of v = (i, j, k) in offsets [first, last) with i in [i_begin, i_end).
+    auto for_neighbors = [&](size_t v, size_t i, size_t j, size_t k, size_t first, size_t last, size_t i_begin,
+                             size_t i_end, auto&& visit) {
+        for (size_t n = first; n < last; ++n) {
+            const auto& o = all[n];
+            // i - 1, j - 1 and k - 1 wrap around past the bounds.
+            if (i + o[0] < i_begin || i + o[0] >= i_end || j + o[1] >= ny || k + o[2] >= nz) continue;
+            visit(v + o[0] * long(slice) + o[1] * long(nz) + o[2]);
+        }
+    };
+
+    const unsigned workers = resolve_thread_count(num_threads, nx);
+    std::vector<std::vector<size_t>> queues(workers);
+
+    // --- 1. Raster and anti-raster scans, one slab at a time ---
+    parallel_for_chunks(0, nx, workers, [&](size_t i_begin, size_t i_end, unsigned w) {
+        const size_t v_begin = i_begin * slice, v_end = i_end * slice;
+        for (size_t v = v_begin; v < v_end; ++v) f[v] = std::min(f[v], g[v]);
+
+        for (size_t v = v_begin; v < v_end; ++v) {
+            const size_t i = v / slice, j = (v / nz) % ny, k = v % nz;
+            T m = f[v];
+            for_neighbors(v, i, j, k, 0, num_before, i_begin, i_end, [&](size_t u) { m = std::max(m, f[u]); });
+            f[v] = std::min(m, g[v]);
+        }
+        std::vector<size_t>& queue = queues[w];
+        for (size_t v = v_end; v-- > v_begin;) {
+            const size_t i = v / slice, j = (v / nz) % ny, k = v % nz;
+            T m = f[v];
+            for_neighbors(v, i, j, k, num_before, all.size(), i_begin, i_end, [&](size_t u) { m = std::max(m, f[u]); });
+            f[v] = std::min(m, g[v]);
+            bool unstable = false;
+            for_neighbors(v, i, j, k, num_before, all.size(), i_begin, i_end,
+                          [&](size_t u) { unstable = unstable || (f[u] < f[v] && f[u] < g[u]); });
+            if (unstable) queue.push_back(v);
+        }
+        // The voxels on the faces between slabs may raise the neighbouring slab.
+        if (i_begin > 0) {
+            for (size_t v = v_begin; v < v_begin + slice; ++v) queue.push_back(v);
+        }
+        if (i_end < nx) {
+            for (size_t v = v_end - slice; v < v_end; ++v) queue.push_back(v);
+        }
+    });
+
+    // --- 2. FIFO propagation ---
+    std::vector<size_t> fifo;
+    for (const auto& queue : queues) fifo.insert(fifo.end(), queue.begin(), queue.end());
+    for (size_t head = 0; head < fifo.size(); ++head) {
+        const size_t v = fifo[head];
+        const size_t i = v / slice, j = (v / nz) % ny, k = v % nz;
+        for_neighbors(v, i, j, k, 0, all.size(), 0, nx, [&](size_t u) {
+            if (f[u] < f[v] && f[u] != g[u]) {
+                f[u] = std::min(f[v], g[u]);
+                fifo.push_back(u);
+            }
+        });
+    }
+}
+
+void fill_holes(Mask3D& mask, int connectivity, unsigned num_threads) {
+    const size_t nx = mask.x_dim, ny = mask.y_dim, nz = mask.z_dim;
+    uint8_t* m = mask.data.data();
+
+    // The background, and the part of it on the border of the volume as marker.
+    Mask3D background = allocate_volume<uint8_t>(mask.x_dim, mask.y_dim, mask.z_dim);
+    Mask3D reached = allocate_volume<uint8_t>(mask.x_dim, mask.y_dim, mask.z_dim);
+    parallel_for_chunks(0, nx, num_threads, [&](size_t b, size_t e, unsigned) {
+        for (size_t i = b; i < e; ++i) {
+            for (size_t j = 0; j < ny; ++j) {
+                for (size_t k = 0; k < nz; ++k) {
+                    const size_t v = k + nz * (j + ny * i);
+                    const bool border = i == 0 || i + 1 == nx || j == 0 || j + 1 == ny || k == 0 || k + 1 == nz;
+                    background.data[v] = m[v] == 0 ? 255 : 0;
+                    reached.data[v] = border ? background.data[v] : 0;
+                }
+            }
+        }
+    });
+    reconstruct_by_dilation(reached, background, connectivity, num_threads);
+
+    // Background voxels not reached from the border are holes.
+    parallel_for_chunks(0, mask.size(), num_threads, [&](size_t b, size_t e, unsigned) {
+        for (size_t v = b; v < e; ++v) {
+            if (background.data[v] != 0 && reached.data[v] == 0) m[v] = 255;
+        }
+    });
+}
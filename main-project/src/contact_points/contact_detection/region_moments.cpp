@@ -0,0 +1,133 @@
+#include "include/region_moments.hpp"
+#include "include/ParallelUtils.h"
+
+#include <algorithm>
+#include <utility>
+#include <vector>
+
+// Explicit template instantiations
+template std::vector<RegionMoments> compute_region_moments<int>(const Volume<int>&, unsigned, bool);
+template std::vector<RegionMoments> compute_region_moments<uint8_t>(const Volume<uint8_t>&, unsigned, bool);
+template std::vector<RegionMoments> compute_region_moments<uint32_t>(const Volume<uint32_t>&, unsigned, bool);
+
+// --- RegionMoments ---
+
+void RegionMoments::add_run(int i, int j, int k0, int n) {
+    const uint64_t un = n, ui = i, uj = j, uk = k0;
+    // Closed forms of the sums of k and k^2 over k0 .. k0 + n - 1.
+    const uint64_t sk = un * uk + un * (un - 1) / 2;
+    const uint64_t skk = un * uk * uk + uk * un * (un - 1) + (un - 1) * un * (2 * un - 1) / 6;
+
+    if (volume == 0) {
+        min = {i, j, k0};
+        max = {i, j, k0 + n - 1};
+    } else {
+        min = {std::min(min[0], i), std::min(min[1], j), std::min(min[2], k0)};
+        max = {std::max(max[0], i), std::max(max[1], j), std::max(max[2], k0 + n - 1)};
+    }
+    volume += un;
+    sum[0] += un * ui;
+    sum[1] += un * uj;
+    sum[2] += sk;
+    sum2[0] += un * ui * ui;
+    sum2[1] += un * uj * uj;
+    sum2[2] += skk;
+    sum2[3] += un * ui * uj;
+    sum2[4] += ui * sk;
+    sum2[5] += uj * sk;
+}
+
+void RegionMoments::merge(const RegionMoments& other) {
+    if (other.volume == 0) return;
+    if (volume == 0) {
+        min = other.min;
+        max = other.max;
+    } else {
+        for (int a = 0; a < 3; ++a) {
+            min[a] = std::min(min[a], other.min[a]);
+            max[a] = std::max(max[a], other.max[a]);
+        }
+    }
+    volume += other.volume;
+    for (int a = 0; a < 3; ++a) sum[a] += other.sum[a];
+    for (int a = 0; a < 6; ++a) sum2[a] += other.sum2[a];
+    boundary_faces += other.boundary_faces;
+}
+
+std::array<double, 3> RegionMoments::centroid() const {
+    const double n = static_cast<double>(volume);
+    return {sum[0] / n, sum[1] / n, sum[2] / n};
+}
+
+std::array<double, 6> RegionMoments::covariance() const {
+    const double n = static_cast<double>(volume);
+    const std::array<double, 3> c = centroid();
+    return {sum2[0] / n - c[0] * c[0], sum2[1] / n - c[1] * c[1], sum2[2] / n - c[2] * c[2],
+            sum2[3] / n - c[0] * c[1], sum2[4] / n - c[0] * c[2], sum2[5] / n - c[1] * c[2]};
+}
+
+// --- Accumulation ---
+
+template<typename T>
+std::vector<RegionMoments> compute_region_moments(const Volume<T>& labels, unsigned num_threads, bool count_faces) {
+    const size_t nx = labels.x_dim, ny = labels.y_dim, nz = labels.z_dim;
+    const size_t slice = ny * nz;
+    const T* in = labels.data.data();
+
+    // The largest label sizes the dense tables.
+    const unsigned workers = resolve_thread_count(num_threads, nx);
+    std::vector<T> largest(workers, T(0));
+    parallel_for_chunks(0, labels.size(), workers, [&](size_t b, size_t e, unsigned w) {
+        for (size_t v = b; v < e; ++v) largest[w] = std::max(largest[w], in[v]);
+    });
+    const size_t num_labels = static_cast<size_t>(*std::max_element(largest.begin(), largest.end()));
+
+    // --- Pass 1: one dense table per slab of slices ---
+    std::vector<std::vector<RegionMoments>> tables(workers);
+    parallel_for_chunks(0, nx, workers, [&](size_t i_begin, size_t i_end, unsigned w) {
+        std::vector<RegionMoments>& table = tables[w];
+        table.resize(num_labels);
+        for (size_t i = i_begin; i < i_end; ++i) {
+            for (size_t j = 0; j < ny; ++j) {
+                const T* row = in + nz * (j + ny * i);
+                for (size_t k = 0; k < nz;) {
+                    const T label = row[k];
+                    size_t end = k + 1;
+                    while (end < nz && row[end] == label) ++end;
+                    if (label > 0) {
+                        RegionMoments& region = table[static_cast<size_t>(label) - 1];
+                        region.add_run(int(i), int(j), int(k), int(end - k));
+                        if (count_faces) {
+                            // Both ends of a run are boundary faces; the other four rows are compared voxel by voxel.
+                            uint64_t faces = 2;
+                            const T* rows[4] = {j > 0 ? row - nz : nullptr, j + 1 < ny ? row + nz : nullptr,
+                                                i > 0 ? row - slice : nullptr, i + 1 < nx ? row + slice : nullptr};
+                            for (const T* other : rows) {
+                                if (other == nullptr) {
+                                    faces += end - k;
+                                    continue;
+                                }
+                                for (size_t r = k; r < end; ++r) faces += other[r] != label;
+                            }
+                            region.boundary_faces += faces;
+                        }
+                    }
+                    k = end;
+                }
+            }
+        }
+    });
+
+    // --- Pass 2: merge the tables label by label ---
+    std::vector<RegionMoments> regions = std::move(tables[0]);
+    regions.resize(num_labels);
+    parallel_for_chunks(0, num_labels, workers, [&](size_t b, size_t e, unsigned) {
+        for (size_t l = b; l < e; ++l) {
+            regions[l].label = static_cast<uint32_t>(l + 1);
+            for (unsigned w = 1; w < workers; ++w) {
+                if (!tables[w].empty()) regions[l].merge(tables[w][l]);
+            }
+        }
+    });
+    return regions;
+}
@@ -0,0 +1,205 @@
+#include "include/skeleton.hpp"
+#include "include/contact_strength.hpp" // For city_block_distance()
+#include "include/ParallelUtils.h"
+
+#include <algorithm>
+#include <cstdlib>
+#include <stdexcept>
+#include <vector>
+
+// Explicit template instantiations
+template Mask3D skeletonize<int>(const Volume<int>&, int, const Volume<int>*, unsigned);
+template Mask3D skeletonize<uint8_t>(const Volume<uint8_t>&, int, const Volume<uint8_t>*, unsigned);
+
+namespace {
+
+const int CENTER = 13; // Bit of the centre voxel in a 3x3x3 neighbourhood.
+
+// Below this many candidates per worker, starting threads for a subfield costs more than its tests.
+const size_t MIN_CANDIDATES_PER_WORKER = 4096;
+
+/**
+ * @brief Bit masks of the 3x3x3 neighbourhood, built once.
+ */
+struct NeighborhoodTables {
+    uint32_t n6 = 0, n18 = 0, n26 = 0; ///< The 6-, 18- and 26-neighbours of the centre.
+    uint32_t adj6[27] = {}, adj26[27] = {}; ///< The 6- and 26-neighbours of each cell, inside the cube.
+
+    NeighborhoodTables() {
+        for (int a = 0; a < 27; ++a) {
+            const int ai = a / 9, aj = a / 3 % 3, ak = a % 3;
+            const int order = (ai != 1) + (aj != 1) + (ak != 1);
+            if (order == 1) n6 |= 1u << a;
+            if (order >= 1 && order <= 2) n18 |= 1u << a;
+            if (order >= 1) n26 |= 1u << a;
+
+            for (int b = 0; b < 27; ++b) {
+                const int di = std::abs(b / 9 - ai), dj = std::abs(b / 3 % 3 - aj), dk = std::abs(b % 3 - ak);
+                if (a == b || b == CENTER) continue;
+                if (di + dj + dk == 1) adj6[a] |= 1u << b;
+                if (std::max(di, std::max(dj, dk)) == 1) adj26[a] |= 1u << b;
+            }
+        }
+    }
+};
+
+const NeighborhoodTables& tables() {
+    static const NeighborhoodTables t;
+    return t;
+}
+
+/**
+ * @brief Counts the components of `set` that contain a cell of `seeds` (stops at 2).
+ */
+int count_components(uint32_t set, const uint32_t* adj, uint32_t seeds) {
+    int count = 0;
+    while ((set & seeds) && count < 2) {
+        const uint32_t start = (set & seeds) & (~(set & seeds) + 1);
+        uint32_t component = start, frontier = start;
+        while (frontier) {
+            const int cell = __builtin_ctz(frontier);
+            frontier &= frontier - 1;
+            const uint32_t grown = adj[cell] & set & ~component;
+            component |= grown;
+            frontier |= grown;
+        }
+        set &= ~component;
+        ++count;
+    }
+    return count;
+}
+
+/**
+ * @brief Reads the 3x3x3 neighbourhood of a voxel as bits (outside the volume is background).
+ */
+uint32_t read_neighborhood(const Mask3D& mask, long i, long j, long k) {
+    uint32_t bits = 0;
+    for (int n = 0; n < 27; ++n) {
+        const long ni = i + n / 9 - 1, nj = j + n / 3 % 3 - 1, nk = k + n % 3 - 1;
+        if (ni < 0 || ni >= mask.x_dim || nj < 0 || nj >= mask.y_dim || nk < 0 || nk >= mask.z_dim) continue;
+        if (mask.at(ni, nj, nk) != 0) bits |= 1u << n;
+    }
+    return bits;
+}
+
+} // namespace
+
+bool is_simple_voxel(uint32_t neighborhood, int connectivity) {
+    const NeighborhoodTables& t = tables();
+    const uint32_t object = neighborhood & t.n26;
+    const uint32_t background = ~neighborhood & t.n26;
+    if (connectivity == 6) {
+        // Object: 6-components of the 18-neighbourhood touching a 6-neighbour; background: 26-components.
+        return count_components(object & t.n18, t.adj6, t.n6) == 1 &&
+               count_components(background, t.adj26, t.n26) == 1;
+    }
+    return count_components(object, t.adj26, t.n26) == 1 &&
+           count_components(background & t.n18, t.adj6, t.n6) == 1;
+}
+
+template<typename T>
+Mask3D skeletonize(const Volume<T>& object, int connectivity, const Volume<T>* inhibit, unsigned num_threads) {
+    if (connectivity != 6 && connectivity != 26) {
+        throw std::invalid_argument("Error: Skeleton connectivity must be 6 or 26.");
+    }
+    if (inhibit && (inhibit->x_dim != object.x_dim || inhibit->y_dim != object.y_dim || inhibit->z_dim != object.z_dim)) {
+        throw std::invalid_argument("Error: Inhibit image dimensions do not match!");
+    }
+
+    const size_t n = object.size();
+    const long ny = object.y_dim, nz = object.z_dim;
+    Mask3D skeleton = allocate_volume<uint8_t>(object.x_dim, object.y_dim, object.z_dim);
+    parallel_for_chunks(0, n, num_threads, [&](size_t b, size_t e, unsigned) {
+        for (size_t v = b; v < e; ++v) skeleton.data[v] = object.data[v] != 0 ? 255 : 0;
+    });
+    const Volume<uint32_t> priority = city_block_distance(object, num_threads);
+
+    // A voxel is queued once; it is queued again only when one of its neighbours is removed.
+    std::vector<uint8_t> queued(n, 0);
+    auto removable = [&](size_t v) {
+        return skeleton.data[v] != 0 && !queued[v] && !(inhibit && inhibit->data[v] != 0);
+    };
+    auto coords = [&](size_t v, long& i, long& j, long& k) {
+        i = static_cast<long>(v / (size_t(ny) * nz));
+        j = static_cast<long>(v / nz % ny);
+        k = static_cast<long>(v % nz);
+    };
+
+    // Bucket queue by priority, seeded with the voxels touching the background. The border voxels
+    // are collected per slab of slices and queued in slab order, so the queue is the same for any
+    // thread count.
+    const size_t slice = size_t(ny) * nz;
+    const unsigned workers = resolve_thread_count(num_threads, object.x_dim);
+    std::vector<std::vector<uint64_t>> borders(workers);
+    std::vector<uint32_t> slab_max(workers, 0);
+    parallel_for_chunks(0, object.x_dim, workers, [&](size_t b, size_t e, unsigned w) {
+        for (size_t v = b * slice; v < e * slice; ++v) {
+            slab_max[w] = std::max(slab_max[w], priority.data[v]);
+            if (!removable(v)) continue;
+            long i, j, k;
+            coords(v, i, j, k);
+            if ((read_neighborhood(skeleton, i, j, k) & tables().n26) != tables().n26) {
+                queued[v] = 1;
+                borders[w].push_back(v);
+            }
+        }
+    });
+    const uint32_t max_priority = *std::max_element(slab_max.begin(), slab_max.end());
+    std::vector<std::vector<uint64_t>> buckets(size_t(max_priority) + 1);
+    for (auto& border : borders) {
+        for (uint64_t v : border) buckets[priority.data[v]].push_back(v);
+        std::vector<uint64_t>().swap(border);
+    }
+
+    std::vector<uint64_t> subfields[8];
+    std::vector<uint8_t> simple;
+    for (size_t level = 0; level < buckets.size(); ++level) {
+        std::vector<uint64_t> active = std::move(buckets[level]);
+        while (!active.empty()) {
+            for (auto& s : subfields) s.clear();
+            for (uint64_t v : active) {
+                long i, j, k;
+                coords(v, i, j, k);
+                subfields[(i & 1) << 2 | (j & 1) << 1 | (k & 1)].push_back(v);
+            }
+            active.clear();
+
+            for (const auto& candidates : subfields) {
+                // No two candidates are 26-adjacent, so each test only reads voxels no other candidate changes.
+                // Small subfields, common in the last rounds of a level, are tested on fewer workers.
+                simple.assign(candidates.size(), 0);
+                const unsigned subfield_workers = std::min(workers,
+                    resolve_thread_count(num_threads, std::max<size_t>(1, candidates.size() / MIN_CANDIDATES_PER_WORKER)));
+                parallel_for_chunks(0, candidates.size(), subfield_workers, [&](size_t b, size_t e, unsigned) {
+                    for (size_t c = b; c < e; ++c) {
+                        long i, j, k;
+                        coords(candidates[c], i, j, k);
+                        simple[c] = is_simple_voxel(read_neighborhood(skeleton, i, j, k), connectivity);
+                    }
+                });
+                for (size_t c = 0; c < candidates.size(); ++c) {
+                    queued[candidates[c]] = 0;
+                    if (simple[c]) skeleton.data[candidates[c]] = 0;
+                }
+
+                // Neighbours of removed voxels may have become simple: retest them at their own level
+                // (or now, if their level has already been processed).
+                for (size_t c = 0; c < candidates.size(); ++c) {
+                    if (!simple[c]) continue;
+                    long i, j, k;
+                    coords(candidates[c], i, j, k);
+                    for (int m = 0; m < 27; ++m) {
+                        const long ni = i + m / 9 - 1, nj = j + m / 3 % 3 - 1, nk = k + m % 3 - 1;
+                        if (ni < 0 || ni >= object.x_dim || nj < 0 || nj >= ny || nk < 0 || nk >= nz) continue;
+                        const size_t w = size_t(nz) * (nj + size_t(ny) * ni) + nk;
+                        if (!removable(w)) continue;
+                        queued[w] = 1;
+                        if (priority.data[w] <= level) active.push_back(w);
+                        else buckets[priority.data[w]].push_back(w);
+                    }
+                }
+            }
+        }
+    }
+    return skeleton;
+}
@@ -0,0 +1,97 @@
+#include "include/stage_graph.hpp"
+#include "include/ParallelUtils.h"
+
+#include <chrono>
+#include <condition_variable>
+#include <deque>
+#include <exception>
+#include <algorithm>
+#include <iostream>
+#include <mutex>
+#include <stdexcept>
+#include <thread>
+
+StageGraph::StageId StageGraph::add(std::string name, std::vector<StageId> dependencies, std::function<void()> body) {
+    const StageId id = stages_.size();
+    for (StageId dependency : dependencies) {
+        if (dependency >= id) {
+            throw std::invalid_argument("Error: Stage '" + name + "' depends on a stage that was not added before it.");
+        }
+    }
+    stages_.push_back({std::move(name), std::move(dependencies), std::move(body)});
+    return id;
+}
+
+size_t StageGraph::width() const {
+    std::vector<size_t> level(stages_.size(), 0);
+    std::vector<size_t> per_level;
+    for (StageId id = 0; id < stages_.size(); ++id) {
+        for (StageId dependency : stages_[id].dependencies) level[id] = std::max(level[id], level[dependency] + 1);
+        if (level[id] >= per_level.size()) per_level.resize(level[id] + 1, 0);
+        ++per_level[level[id]];
+    }
+    return per_level.empty() ? 0 : *std::max_element(per_level.begin(), per_level.end());
+}
+
+void StageGraph::run(unsigned num_threads) {
+    const size_t count = stages_.size();
+    if (count == 0) return;
+
+    // Stages only depend on earlier stages, so the graph is acyclic by construction.
+    std::vector<std::vector<StageId>> dependents(count);
+    std::vector<size_t> waiting(count);
+    std::deque<StageId> ready;
+    for (StageId id = 0; id < count; ++id) {
+        waiting[id] = stages_[id].dependencies.size();
+        for (StageId dependency : stages_[id].dependencies) dependents[dependency].push_back(id);
+        if (waiting[id] == 0) ready.push_back(id);
+    }
+
+    std::mutex mutex;
+    std::condition_variable wake;
+    size_t finished = 0, running = 0;
+    std::exception_ptr error;
+
+    auto worker = [&]() {
+        std::unique_lock<std::mutex> lock(mutex);
+        while (true) {
+            wake.wait(lock, [&] { return !ready.empty() || finished == count || (error && running == 0); });
+            if (ready.empty() || error) return;
+
+            const StageId id = ready.front();
+            ready.pop_front();
+            ++running;
+            lock.unlock();
+
+            std::exception_ptr failure;
+            const auto start = std::chrono::steady_clock::now();
+            try {
+                stages_[id].body();
+            } catch (...) {
+                failure = std::current_exception();
+            }
+            const std::chrono::duration<double> elapsed = std::chrono::steady_clock::now() - start;
+
+            lock.lock();
+            --running;
+            ++finished;
+            if (failure) {
+                if (!error) error = failure;
+            } else {
+                std::cout << "Stage '" << stages_[id].name << "' done in " << elapsed.count() << " s." << std::endl;
+                for (StageId next : dependents[id]) {
+                    if (--waiting[next] == 0) ready.push_back(next);
+                }
+            }
+            wake.notify_all();
+        }
+    };
+
+    const unsigned workers = resolve_thread_count(num_threads == 0 ? unsigned(width()) : num_threads, count);
+    std::vector<std::thread> threads;
+    threads.reserve(workers);
+    for (unsigned w = 0; w < workers; ++w) threads.emplace_back(worker);
+    for (auto& t : threads) t.join();
+
+    if (error) std::rethrow_exception(error);
+}
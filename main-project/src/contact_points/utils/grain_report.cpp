@@ -0,0 +1,154 @@
+#include "src/include/grain_report.hpp"
+#include "src/include/ImageProcessingUtils.h"
+#include "src/include/region_moments.hpp"
+#include "src/include/ParallelUtils.h"
+#include "src/include/volume_xtensor.hpp"
+
+#include <algorithm>
+#include <cmath>
+#include <fstream>
+#include <iostream>
+#include <stdexcept>
+#include <string>
+#include <vector>
+
+// Explicit template instantiations
+template std::vector<GrainMorphometry> compute_grain_report<int>(const Image3D&, unsigned);
+template std::vector<GrainMorphometry> compute_grain_report<uint8_t>(const Mask3D&, unsigned);
+template std::vector<GrainMorphometry> compute_grain_report<uint32_t>(const Labels3D&, unsigned);
+
+namespace {
+
+/**
+ * @brief Diagonalizes a symmetric 3x3 matrix (ii, jj, kk, ij, ik, jk) with Jacobi rotations.
+ * @param values Set to the eigenvalues, in decreasing order.
+ * @param major Set to the unit eigenvector of the largest eigenvalue (first non-zero component positive).
+ */
+void symmetric_eigen(const std::array<double, 6>& m, std::array<double, 3>& values, std::array<double, 3>& major) {
+    double a[3][3] = {{m[0], m[3], m[4]}, {m[3], m[1], m[5]}, {m[4], m[5], m[2]}};
+    double v[3][3] = {{1, 0, 0}, {0, 1, 0}, {0, 0, 1}};
+    for (int sweep = 0; sweep < 32; ++sweep) {
+        const double off = a[0][1] * a[0][1] + a[0][2] * a[0][2] + a[1][2] * a[1][2];
+        const double diagonal = a[0][0] * a[0][0] + a[1][1] * a[1][1] + a[2][2] * a[2][2];
+        if (off <= 1e-24 * diagonal || off == 0.0) break;
+        for (int p = 0; p < 2; ++p) {
+            for (int q = p + 1; q < 3; ++q) {
+                if (a[p][q] == 0.0) continue;
+                const double theta = (a[q][q] - a[p][p]) / (2.0 * a[p][q]);
+                const double t = (theta >= 0 ? 1.0 : -1.0) / (std::abs(theta) + std::sqrt(theta * theta + 1.0));
+                const double c = 1.0 / std::sqrt(t * t + 1.0), s = t * c;
+                for (int k = 0; k < 3; ++k) {
+                    const double akp = a[k][p], akq = a[k][q];
+                    a[k][p] = c * akp - s * akq;
+                    a[k][q] = s * akp + c * akq;
+                }
+                for (int k = 0; k < 3; ++k) {
+                    const double apk = a[p][k], aqk = a[q][k];
+                    a[p][k] = c * apk - s * aqk;
+                    a[q][k] = s * apk + c * aqk;
+                }
+                for (int k = 0; k < 3; ++k) {
+                    const double vkp = v[k][p], vkq = v[k][q];
+                    v[k][p] = c * vkp - s * vkq;
+                    v[k][q] = s * vkp + c * vkq;
+                }
+            }
+        }
+    }
+
+    int order[3] = {0, 1, 2};
+    std::sort(order, order + 3, [&](int x, int y) { return a[x][x] > a[y][y]; });
+    for (int n = 0; n < 3; ++n) values[n] = a[order[n]][order[n]];
+    major = {v[0][order[0]], v[1][order[0]], v[2][order[0]]};
+    const double first = major[0] != 0.0 ? major[0] : major[1] != 0.0 ? major[1] : major[2];
+    if (first < 0) major = {-major[0], -major[1], -major[2]};
+}
+
+} // namespace
+
+// --- Main Module Logic ---
+
+template<typename T>
+std::vector<GrainMorphometry> compute_grain_report(const Volume<T>& labels, unsigned num_threads) {
+    // --- 1. One pass over the labels: moments, bounding boxes and boundary faces ---
+    const std::vector<RegionMoments> regions = compute_region_moments(labels, num_threads, true);
+
+    std::vector<const RegionMoments*> present;
+    for (const RegionMoments& region : regions) {
+        if (region.volume != 0) present.push_back(&region);
+    }
+
+    // --- 2. Derived measures, per grain ---
+    const double pi = std::acos(-1.0);
+    std::vector<GrainMorphometry> report(present.size());
+    parallel_for(0, present.size(), num_threads, [&](size_t g) {
+        const RegionMoments& region = *present[g];
+        GrainMorphometry& grain = report[g];
+        grain.label = region.label;
+        grain.volume = region.volume;
+        grain.surface_area = 2.0 / 3.0 * static_cast<double>(region.boundary_faces);
+        grain.sphericity = std::cbrt(pi) * std::pow(6.0 * region.volume, 2.0 / 3.0) / grain.surface_area;
+        grain.centroid = region.centroid();
+        grain.bbox_min = region.min;
+        grain.bbox_max = region.max;
+
+        // A solid ellipsoid of semi-axis a has a variance of a^2 / 5 along that axis.
+        std::array<double, 6> covariance = region.covariance();
+        for (int a = 0; a < 3; ++a) covariance[a] += 1.0 / 12.0;
+        std::array<double, 3> variances;
+        symmetric_eigen(covariance, variances, grain.major_axis);
+        for (int a = 0; a < 3; ++a) grain.axes[a] = std::sqrt(5.0 * std::max(variances[a], 0.0));
+    });
+    return report;
+}
+
+void write_grain_report(const std::string& outputPath, const std::vector<GrainMorphometry>& report) {
+    std::ofstream file(outputPath);
+    if (!file.is_open()) {
+        throw std::runtime_error("Error: Could not create output file: " + outputPath);
+    }
+
+    file << "Label Volume SurfaceArea Sphericity CentroidZ CentroidY CentroidX Axis1 Axis2 Axis3"
+            " MajorZ MajorY MajorX MinZ MinY MinX MaxZ MaxY MaxX\n";
+    for (const GrainMorphometry& g : report) {
+        file << g.label << ' ' << g.volume << ' ' << g.surface_area << ' ' << g.sphericity;
+        for (double c : g.centroid) file << ' ' << c;
+        for (double a : g.axes) file << ' ' << a;
+        for (double d : g.major_axis) file << ' ' << d;
+        for (int b : g.bbox_min) file << ' ' << b;
+        for (int b : g.bbox_max) file << ' ' << b;
+        file << '\n';
+    }
+    if (!file) {
+        throw std::runtime_error("Error: Failed to write the grain report to " + outputPath);
+    }
+}
+
+void run_grain_report(const std::string& labelsPath, const std::string& outputPath) {
+    std::cout << "--- Module: grainReport ---" << std::endl;
+
+    // --- 1. Data Loading ---
+    // The labels are decoded straight into the volume that is measured.
+    Labels3D labels;
+    try {
+        labels = adopt_volume(read_tiff_image_xt<uint32_t>(labelsPath));
+    } catch (const std::exception& e) {
+        std::cerr << e.what() << " Aborting." << std::endl;
+        return;
+    }
+
+    // --- 2. Morphometry ---
+    std::vector<GrainMorphometry> report = compute_grain_report(labels);
+    std::cout << "Grain report complete: " << report.size() << " grains." << std::endl;
+
+    // --- 3. Saving Results ---
+    try {
+        write_grain_report(outputPath, report);
+    } catch (const std::exception& e) {
+        std::cerr << e.what() << std::endl;
+        return;
+    }
+
+    std::cout << "Grain report saved to " << outputPath << std::endl;
+    std::cout << "--- Module Finished: grainReport ---" << std::endl;
+}
@@ -0,0 +1,247 @@
+#include "src/include/granulometry.hpp"
+#include "src/include/connected_components.hpp"
+#include "src/include/ImageProcessingUtils.h"
+#include "src/include/morphology.hpp"
+#include "src/include/ParallelUtils.h"
+#include "src/include/volume_xtensor.hpp"
+
+#include <algorithm>
+#include <cmath>
+#include <fstream>
+#include <iostream>
+#include <stdexcept>
+#include <string>
+#include <utility>
+#include <vector>
+
+// Explicit template instantiations
+template Granulometry compute_granulometry<int>(const Image3D&, int, unsigned);
+template Granulometry compute_granulometry<uint8_t>(const Mask3D&, int, unsigned);
+
+namespace {
+
+/**
+ * @brief A maximal inscribed ball: its center and squared radius.
+ */
+struct Ball {
+    long i, j, k;
+    uint32_t r2;
+};
+
+/**
+ * @brief Returns the largest integer d with d * d < x (x >= 1).
+ */
+long largest_below(uint64_t x) {
+    long d = static_cast<long>(std::sqrt(static_cast<double>(x)));
+    while (d > 0 && uint64_t(d) * d >= x) --d;
+    while (uint64_t(d + 1) * (d + 1) < x) ++d;
+    return d;
+}
+
+/**
+ * @brief Returns floor(sqrt(x)).
+ */
+size_t floor_sqrt(uint64_t x) {
+    return static_cast<size_t>(largest_below(x + 1));
+}
+
+/**
+ * @brief The per-grain sums of one worker.
+ */
+struct GrainTotals {
+    std::vector<uint64_t> volume;
+    std::vector<uint32_t> max_r2;
+    std::vector<double> radius_sum;
+    std::vector<uint64_t> spectrum;
+};
+
+} // namespace
+
+// --- Main Module Logic ---
+
+template<typename T>
+Granulometry compute_granulometry(const Volume<T>& binary, int connectivity, unsigned num_threads) {
+    const long nx = binary.x_dim, ny = binary.y_dim, nz = binary.z_dim;
+    const unsigned workers = resolve_thread_count(num_threads, size_t(nx));
+
+    // --- 1. Distance transform; the outside of the volume counts as background ---
+    Granulometry result;
+    Labels3D& thickness = result.thickness;
+    thickness = squared_distance_transform(binary, workers);
+    uint32_t* d = thickness.data.data();
+    parallel_for_chunks(0, size_t(nx), workers, [&](size_t b, size_t e, unsigned) {
+        for (long i = long(b); i < long(e); ++i) {
+            for (long j = 0; j < ny; ++j) {
+                for (long k = 0; k < nz; ++k) {
+                    const uint64_t edge = std::min({i + 1, nx - i, j + 1, ny - j, k + 1, nz - k});
+                    uint32_t& v = d[k + nz * (j + ny * i)];
+                    v = static_cast<uint32_t>(std::min<uint64_t>(v, edge * edge));
+                }
+            }
+        }
+    });
+
+    // --- 2. Maximal balls: centers whose ball no 26-neighbour's ball contains ---
+    std::vector<std::vector<Ball>> found(workers);
+    parallel_for_chunks(0, size_t(nx), workers, [&](size_t b, size_t e, unsigned w) {
+        for (long i = long(b); i < long(e); ++i) {
+            for (long j = 0; j < ny; ++j) {
+                for (long k = 0; k < nz; ++k) {
+                    const uint32_t r2 = d[k + nz * (j + ny * i)];
+                    if (r2 == 0) continue;
+                    const double r = std::sqrt(double(r2));
+                    bool maximal = true;
+                    for (int di = -1; di <= 1 && maximal; ++di) {
+                        for (int dj = -1; dj <= 1 && maximal; ++dj) {
+                            for (int dk = -1; dk <= 1 && maximal; ++dk) {
+                                const long a = i + di, bj = j + dj, c = k + dk;
+                                if (a < 0 || a >= nx || bj < 0 || bj >= ny || c < 0 || c >= nz) continue;
+                                const uint32_t other = d[c + nz * (bj + ny * a)];
+                                if (other <= r2) continue;
+                                maximal = r + std::sqrt(double(di * di + dj * dj + dk * dk)) > std::sqrt(double(other));
+                            }
+                        }
+                    }
+                    if (maximal) found[w].push_back({i, j, k, r2});
+                }
+            }
+        }
+    });
+    // The slabs are concatenated in order, so the balls are sorted by i.
+    std::vector<Ball> balls;
+    long max_ri = 0;
+    for (auto& part : found) {
+        for (const Ball& ball : part) max_ri = std::max(max_ri, largest_below(ball.r2));
+        balls.insert(balls.end(), part.begin(), part.end());
+        std::vector<Ball>().swap(part);
+    }
+
+    // --- 3. Propagate the maximal balls: each voxel keeps the largest ball covering it ---
+    // The distance volume is reused for the thickness; each slab paints its own rows of the
+    // balls that can reach it, i.e. those centered within max_ri slices of the slab.
+    std::fill(d, d + thickness.size(), 0u);
+    parallel_for_chunks(0, size_t(nx), workers, [&](size_t b, size_t e, unsigned) {
+        const auto by_i = [](const Ball& ball, long i) { return ball.i < i; };
+        const auto first = std::lower_bound(balls.begin(), balls.end(), long(b) - max_ri, by_i);
+        const auto last = std::lower_bound(first, balls.end(), long(e) + max_ri, by_i);
+        for (auto it = first; it != last; ++it) {
+            const Ball& ball = *it;
+            const long ri = largest_below(ball.r2);
+            const long i_begin = std::max(ball.i - ri, long(b)), i_end = std::min(ball.i + ri + 1, long(e));
+            for (long i = i_begin; i < i_end; ++i) {
+                const uint64_t rem_i = ball.r2 - uint64_t((i - ball.i) * (i - ball.i));
+                const long rj = largest_below(rem_i);
+                const long j_begin = std::max(ball.j - rj, 0L), j_end = std::min(ball.j + rj + 1, ny);
+                for (long j = j_begin; j < j_end; ++j) {
+                    const long rk = largest_below(rem_i - uint64_t((j - ball.j) * (j - ball.j)));
+                    const long k_begin = std::max(ball.k - rk, 0L), k_end = std::min(ball.k + rk + 1, nz);
+                    uint32_t* row = d + nz * (j + ny * i);
+                    for (long k = k_begin; k < k_end; ++k) row[k] = std::max(row[k], ball.r2);
+                }
+            }
+        }
+    });
+
+    // --- 4. Size histogram and per-grain measures, in one pass ---
+    size_t num_grains = 0;
+    const Labels3D labels = label_connected_components(binary, connectivity, num_grains, workers);
+    std::vector<GrainTotals> totals(workers);
+    parallel_for_chunks(0, thickness.size(), workers, [&](size_t b, size_t e, unsigned w) {
+        GrainTotals& t = totals[w];
+        t.volume.assign(num_grains, 0);
+        t.max_r2.assign(num_grains, 0);
+        t.radius_sum.assign(num_grains, 0.0);
+        for (size_t v = b; v < e; ++v) {
+            if (labels.data[v] == 0) continue;
+            const size_t g = labels.data[v] - 1;
+            const size_t bin = floor_sqrt(d[v]);
+            if (bin >= t.spectrum.size()) t.spectrum.resize(bin + 1, 0);
+            ++t.spectrum[bin];
+            ++t.volume[g];
+            t.max_r2[g] = std::max(t.max_r2[g], d[v]);
+            t.radius_sum[g] += std::sqrt(double(d[v]));
+        }
+    });
+
+    const double pi = std::acos(-1.0);
+    result.grains.resize(num_grains);
+    for (size_t g = 0; g < num_grains; ++g) {
+        GrainSize& grain = result.grains[g];
+        grain.label = static_cast<uint32_t>(g + 1);
+        uint32_t max_r2 = 0;
+        double radius_sum = 0.0;
+        for (const GrainTotals& t : totals) {
+            if (t.volume.empty()) continue;
+            grain.volume += t.volume[g];
+            max_r2 = std::max(max_r2, t.max_r2[g]);
+            radius_sum += t.radius_sum[g];
+        }
+        grain.equivalent_radius = std::cbrt(3.0 * grain.volume / (4.0 * pi));
+        grain.inscribed_radius = std::sqrt(double(max_r2));
+        grain.mean_thickness = radius_sum / grain.volume;
+    }
+    for (const GrainTotals& t : totals) {
+        if (t.spectrum.size() > result.spectrum.size()) result.spectrum.resize(t.spectrum.size(), 0);
+        for (size_t bin = 0; bin < t.spectrum.size(); ++bin) result.spectrum[bin] += t.spectrum[bin];
+    }
+    return result;
+}
+
+void write_granulometry(const std::string& outputPrefix, const Granulometry& granulometry) {
+    const std::string spectrumPath = outputPrefix + "_spectrum.csv";
+    std::ofstream spectrum(spectrumPath);
+    if (!spectrum.is_open()) {
+        throw std::runtime_error("Error: Could not create output file: " + spectrumPath);
+    }
+    spectrum << "Radius,Voxels,OpeningVolume\n";
+    uint64_t opening = 0;
+    for (uint64_t count : granulometry.spectrum) opening += count;
+    for (size_t r = 0; r < granulometry.spectrum.size(); ++r) {
+        spectrum << r << "," << granulometry.spectrum[r] << "," << opening << "\n";
+        opening -= granulometry.spectrum[r];
+    }
+
+    const std::string grainsPath = outputPrefix + "_grains.csv";
+    std::ofstream grains(grainsPath);
+    if (!grains.is_open()) {
+        throw std::runtime_error("Error: Could not create output file: " + grainsPath);
+    }
+    grains << "Label,Volume,EquivalentRadius,InscribedRadius,MeanThickness\n";
+    for (const GrainSize& g : granulometry.grains) {
+        grains << g.label << "," << g.volume << "," << g.equivalent_radius << "," << g.inscribed_radius << ","
+               << g.mean_thickness << "\n";
+    }
+    if (!spectrum || !grains) {
+        throw std::runtime_error("Error: Failed to write the granulometry to " + outputPrefix);
+    }
+}
+
+void run_granulometry(const std::string& inputFile, const std::string& outputPrefix) {
+    std::cout << "--- Module: granulometry ---" << std::endl;
+
+    // --- 1. Data Loading ---
+    // Thresholding at 1 while decoding turns any unsigned binary image into a 0/255 mask.
+    Mask3D binary_image;
+    try {
+        binary_image = adopt_volume(read_tiff_image_xt<uint8_t>(inputFile, VoxelTransform::threshold(1, 255)));
+    } catch (const std::exception& e) {
+        std::cerr << e.what() << " Aborting." << std::endl;
+        return;
+    }
+
+    // --- 2. Distance Map, Maximal Balls and Histograms ---
+    Granulometry granulometry = compute_granulometry(binary_image);
+    std::cout << "Granulometry complete: " << granulometry.grains.size() << " grains, largest opening radius "
+              << (granulometry.spectrum.empty() ? 0 : granulometry.spectrum.size() - 1) << "." << std::endl;
+
+    // --- 3. Saving Results ---
+    try {
+        write_granulometry(outputPrefix, granulometry);
+    } catch (const std::exception& e) {
+        std::cerr << e.what() << std::endl;
+        return;
+    }
+
+    std::cout << "Granulometry saved to " << outputPrefix << "_*.csv" << std::endl;
+    std::cout << "--- Module Finished: granulometry ---" << std::endl;
+}
@@ -1,7 +1,9 @@
 #include "src/include/minTree.hpp"
+#include "src/include/volume_xtensor.hpp"
 
 // C++ Library Includes
 #include <iostream>
+#include <stdexcept>
 #include <string>
 #include <vector>
 
@@ -32,53 +34,63 @@ void saveTiffImage_xt(const std::string& path, const xt::xarray<unsigned char>&
 
 // --- Main Module Logic ---
 
-void run_minTree(const std::string& inputFile, int adjacency, const std::string& outputFile) {
-    std::cout << "--- Module: minTree ---" << std::endl;
-    
-    // --- 1. Data Loading ---
-    long x_dim, y_dim, z_dim;
-    xt::xarray<unsigned char> image = loadTiffImage_xt(inputFile, x_dim, y_dim, z_dim);
-    if (image.size() == 0) {
-        std::cerr << "Error: Failed to load image. Aborting." << std::endl;
-        return;
+Mask3D extract_min_tree_cores(const Mask3D& volume, int adjacency) {
+    if (adjacency != 6 && adjacency != 26) {
+        throw std::invalid_argument("Error: Min-tree adjacency must be 6 or 26.");
     }
-    // Note: The Python script's normalization `(image/256).astype("uint8")` is implicitly
-    // handled by loading the data directly as unsigned char.
+    xt::xtensor<unsigned char, 3> image = as_xtensor(volume);
 
-    // --- 2. Higra C++ Processing Pipeline ---
-    
     // Build the implicit image graph based on shape and connectivity.
-    auto graph = hg::get_nd_regular_implicit_graph(image.shape());
+    auto graph = hg::make_graph_from_implicit_graph(
+        hg::get_3d_implicit_graph(image.shape(), adjacency == 26 ? hg::adjacency::cube : hg::adjacency::face));
 
     // Construct the component tree (min-tree) and compute node altitudes.
-    auto [tree, altitudes] = hg::component_tree_min_tree(graph, image);
+    auto [tree, altitudes] = hg::component_tree_min_tree(graph, hg::xtensor_to_array_view(image));
 
-    [cite_start]// Compute area and height attributes for each node in the tree. [cite: 158, 161]
+    // Compute area and height attributes for each node in the tree.
     auto area = hg::attribute_area(tree);
-    auto height = hg::attribute_height(tree, altitudes);
+    auto height = hg::attribute_height(tree, hg::xtensor_to_array_view(altitudes));
     
-    [cite_start]// Define filtering criteria to identify and remove unwanted nodes. [cite: 205]
+    // Define filtering criteria to identify and remove unwanted nodes.
     // The goal is to keep nodes that represent grain cores: those with high contrast (height) and small area.
     double max_height = xt::amax(height)(); // () gets the scalar value
     double avg_area = xt::mean(area)();
     
-    [cite_start]// The filtering criteria mentioned in the report. [cite: 206, 207]
-    auto unwanted_nodes = xt::logical_or(height < 0.14 * max_height, area > avg_area);
+    // The filtering criteria mentioned in the report.
+    auto unwanted_nodes = xt::operator||(height < 0.14 * max_height, area > avg_area);
 
     // Simplify the tree by removing the unwanted nodes.
-    auto [simplified_tree, node_map] = hg::simplify_tree(tree, unwanted_nodes);
-    auto new_altitudes = hg::map_ महीपत(altitudes, node_map);
+    auto [simplified_tree, node_map] = hg::simplify_tree(tree, hg::xtensor_to_array_view(unwanted_nodes));
+    auto new_altitudes = hg::map_on_tree(simplified_tree, node_map, hg::xtensor_to_array_view(altitudes));
 
     // Reconstruct a new image from the leaf data of the simplified tree.
-    auto reconstructed_image = hg::reconstruct_leaf_data(simplified_tree, new_altitudes);
+    auto reconstructed = hg::reconstruct_leaf_data(simplified_tree, new_altitudes);
+    auto reconstructed_image = xt::adapt(reconstructed.data(), image.shape());
     
     // Binarize and scale the result to a displayable 8-bit image (0 or 255).
     unsigned char max_res_val = xt::amax(reconstructed_image)();
-    auto final_image = xt::cast<unsigned char>((reconstructed_image < max_res_val) * 255);
+    return adopt_volume(xt::xtensor<unsigned char, 3>(xt::cast<unsigned char>((reconstructed_image < max_res_val) * 255)));
+}
+
+void run_minTree(const std::string& inputFile, int adjacency, const std::string& outputFile) {
+    std::cout << "--- Module: minTree ---" << std::endl;
+    
+    // --- 1. Data Loading ---
+    long x_dim, y_dim, z_dim;
+    xt::xarray<unsigned char> image = loadTiffImage_xt(inputFile, x_dim, y_dim, z_dim);
+    if (image.size() == 0) {
+        std::cerr << "Error: Failed to load image. Aborting." << std::endl;
+        return;
+    }
+    // Note: The Python script's normalization `(image/256).astype("uint8")` is implicitly
+    // handled by loading the data directly as unsigned char.
+
+    // --- 2. Higra C++ Processing Pipeline ---
+    Mask3D cores = extract_min_tree_cores(borrow_volume(image), adjacency);
 
     // --- 3. Saving Results ---
-    saveTiffImage_xt(outputFile, final_image);
+    saveTiffImage_xt(outputFile, as_xtensor(cores));
 
     std::cout << "minTree file saved to " << outputFile << std::endl;
     std::cout << "--- Module Finished: minTree ---" << std::endl;
-}
\ No newline at end of file
+}
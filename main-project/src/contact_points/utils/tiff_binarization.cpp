@@ -1,5 +1,6 @@
 #include "src/include/tiff_binarization.hpp"
 #include "src/include/common.hpp" // For the Image3D struct
+#include "src/include/ParallelUtils.h"
 
 #include <iostream>
 #include <string>
@@ -7,6 +8,8 @@
 
 // --- I/O Placeholders (Requires libtiff) ---
 
+namespace {
+
 /**
  * @brief Placeholder function to load a TIFF image.
  * @note A real implementation requires a library like libtiff.
@@ -24,9 +27,19 @@ void saveTiffImage_generic(const std::string& path, const Image3D& image) {
     std::cout << "WARNING: Function 'saveTiffImage_generic' is not implemented." << std::endl;
 }
 
+} // namespace
+
 
 // --- Main Module Logic ---
 
+Mask3D binarize(const Image3D& image, int threshold, unsigned num_threads) {
+    Mask3D binary = allocate_volume<uint8_t>(image.x_dim, image.y_dim, image.z_dim);
+    parallel_for_chunks(0, image.size(), num_threads, [&](size_t b, size_t e, unsigned) {
+        for (size_t i = b; i < e; ++i) binary.data[i] = image.data[i] >= threshold ? 255 : 0;
+    });
+    return binary;
+}
+
 void run_tiff_binarization(const std::string& inputFile, int threshold, const std::string& outputFile) {
     std::cout << "--- Module: tiff_binarization ---" << std::endl;
 
@@ -39,20 +52,7 @@ void run_tiff_binarization(const std::string& inputFile, int threshold, const st
     std::cout << "Image '" << inputFile << "' loaded." << std::endl;
 
     // --- 2. Binarization ---
-    // Create a new image for the result with the same dimensions.
-    Image3D binarized_image = {
-        std::vector<int>(input_image.data.size()),
-        input_image.x_dim,
-        input_image.y_dim,
-        input_image.z_dim
-    };
-
-    // Iterate through each pixel and apply the threshold.
-    for (size_t i = 0; i < input_image.data.size(); ++i) {
-        // The expression (value >= threshold) results in `true` (1) or `false` (0).
-        // This is then multiplied by 255 to get the final binary value.
-        binarized_image.data[i] = (input_image.data[i] >= threshold) * 255;
-    }
+    Image3D binarized_image = convert_volume<int>(binarize(input_image, threshold));
     std::cout << "Binarization complete with threshold = " << threshold << std::endl;
 
     // --- 3. Saving the Result ---
@@ -1,13 +1,21 @@
 #include "src/include/tiff_binary_sum.hpp"
 #include "src/include/common.hpp" // For the Image3D struct
+#include "src/include/ParallelUtils.h"
 
 #include <iostream>
+#include <stdexcept>
 #include <string>
 #include <vector>
 
+// Explicit template instantiations
+template Mask3D binary_sum<int>(const Image3D&, const Image3D&, unsigned);
+template Mask3D binary_sum<uint8_t>(const Mask3D&, const Mask3D&, unsigned);
+
 // --- I/O Placeholders (Requires libtiff) ---
 
 // IMPORTANT: These are placeholders. A real implementation requires a TIFF library.
+namespace {
+
 Image3D loadTiffImage_generic(const std::string& path) {
     std::cout << "WARNING: Function 'loadTiffImage_generic' is not implemented." << std::endl;
     return {};
@@ -17,9 +25,23 @@ void saveTiffImage_generic(const std::string& path, const Image3D& image) {
     std::cout << "WARNING: Function 'saveTiffImage_generic' is not implemented." << std::endl;
 }
 
+} // namespace
+
 
 // --- Main Module Logic ---
 
+template<typename T>
+Mask3D binary_sum(const Volume<T>& first, const Volume<T>& second, unsigned num_threads) {
+    if (first.x_dim != second.x_dim || first.y_dim != second.y_dim || first.z_dim != second.z_dim) {
+        throw std::invalid_argument("Error: Input image dimensions do not match!");
+    }
+    Mask3D sum = allocate_volume<uint8_t>(first.x_dim, first.y_dim, first.z_dim);
+    parallel_for_chunks(0, first.size(), num_threads, [&](size_t b, size_t e, unsigned) {
+        for (size_t i = b; i < e; ++i) sum.data[i] = (first.data[i] >= 255 || second.data[i] >= 255) ? 255 : 0;
+    });
+    return sum;
+}
+
 void run_tiff_binary_sum(const std::string& inputFile1, const std::string& inputFile2, const std::string& outputFile) {
     std::cout << "--- Module: tiff_binary_sum ---" << std::endl;
 
@@ -41,18 +63,7 @@ void run_tiff_binary_sum(const std::string& inputFile1, const std::string& input
 
 
     // --- 3. Binary Sum (Logical OR) ---
-    Image3D sum_image = {
-        std::vector<int>(image1.data.size()),
-        image1.x_dim,
-        image1.y_dim,
-        image1.z_dim
-    };
-
-    for (size_t i = 0; i < image1.data.size(); ++i) {
-        // If the pixel value is >= 255 (white) in either image, the output pixel is 255.
-        // The result of the || (OR) operation is `true` (1) or `false` (0).
-        sum_image.data[i] = (image1.data[i] >= 255 || image2.data[i] >= 255) * 255;
-    }
+    Image3D sum_image = convert_volume<int>(binary_sum(image1, image2));
     std::cout << "Binary sum complete." << std::endl;
 
 
@@ -11,7 +11,7 @@
  #include <iostream>
  #include <fstream>
  #include <sstream>
- #include <algorithm> // For std::find
+ #include <algorithm> // For std::find and std::copy
  #include <stdexcept> // For std::out_of_range
  
  //
@@ -85,6 +85,36 @@
      }
  }
  
+ void GrainNetwork::load_morphometry(const std::string& filepath) {
+     std::ifstream file(filepath);
+     if (!file.is_open()) {
+         std::cerr << "Error: Failed to open grain report: " << filepath << std::endl;
+         return;
+     }
+ 
+     std::string line;
+     std::getline(file, line); // Skip the header line.
+ 
+     int label;
+     double volume, surface_area, sphericity, z, y, x;
+     double axes[3];
+     while (std::getline(file, line)) {
+         std::stringstream ss(line);
+         // Expected format: Label Volume SurfaceArea Sphericity Zc Yc Xc Axis1 Axis2 Axis3 ...
+         if (!(ss >> label >> volume >> surface_area >> sphericity >> z >> y >> x >> axes[0] >> axes[1] >> axes[2])) {
+             continue;
+         }
+ 
+         auto it = grains.find(label);
+         if (it == grains.end()) it = grains.emplace(label, Grain(label, x, y, z)).first;
+         Grain& grain = it->second;
+         grain.volume = volume;
+         grain.surface_area = surface_area;
+         grain.sphericity = sphericity;
+         std::copy(axes, axes + 3, grain.axes);
+     }
+ }
+ 
  std::pair<std::vector<Grain*>, std::vector<Grain*>> GrainNetwork::get_connected_status() {
      std::vector<Grain*> connected;
      std::vector<Grain*> unconnected;
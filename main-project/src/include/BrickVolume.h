@@ -0,0 +1,197 @@
+/**
+ * @file BrickVolume.h
+ * @brief Declares a chunked, compressed on-disk volume format for out-of-core processing.
+ *
+ * A brick volume splits a (depth, height, width) volume into fixed-size bricks
+ * (64x64x64 by default) that are compressed independently. It is stored as two files:
+ * - `<base>.bricks`: the compressed bricks, concatenated in the order they were written;
+ * - `<base>.bidx`:   a small index with the volume geometry and the offset/size of every brick.
+ *
+ * Any brick, or any axis-aligned region of interest, can be read without touching the
+ * rest of the volume, which is what allows scans larger than memory to be processed.
+ */
+
+ #ifndef BRICK_VOLUME_H
+ #define BRICK_VOLUME_H
+
+ #include <algorithm>
+ #include <array>
+ #include <cstdint>
+ #include <cstdio>
+ #include <string>
+ #include <vector>
+ #include "xtensor/xtensor.hpp"
+ #include "Codec.h"
+
+ /**
+  * @brief Geometry and storage layout of a brick volume.
+  */
+ struct BrickVolumeInfo {
+     std::array<size_t, 3> shape{};                 ///< Volume shape (depth, height, width).
+     std::array<size_t, 3> brick_shape{64, 64, 64}; ///< Brick shape (depth, height, width).
+     Compression compression = Compression::Deflate;
+     uint32_t bytes_per_voxel = 0;                  ///< Voxel size, checked against the reader type.
+
+     /// @brief Returns the number of bricks along each axis.
+     std::array<size_t, 3> grid() const {
+         return {(shape[0] + brick_shape[0] - 1) / brick_shape[0],
+                 (shape[1] + brick_shape[1] - 1) / brick_shape[1],
+                 (shape[2] + brick_shape[2] - 1) / brick_shape[2]};
+     }
+
+     /// @brief Returns the total number of bricks.
+     size_t brick_count() const {
+         auto g = grid();
+         return g[0] * g[1] * g[2];
+     }
+
+     /// @brief Returns the linear index of brick (bz, by, bx).
+     size_t brick_index(size_t bz, size_t by, size_t bx) const {
+         auto g = grid();
+         return (bz * g[1] + by) * g[2] + bx;
+     }
+
+     /// @brief Returns the actual shape of brick (bz, by, bx), clipped at the volume border.
+     std::array<size_t, 3> brick_extent(size_t bz, size_t by, size_t bx) const {
+         return {std::min(brick_shape[0], shape[0] - bz * brick_shape[0]),
+                 std::min(brick_shape[1], shape[1] - by * brick_shape[1]),
+                 std::min(brick_shape[2], shape[2] - bx * brick_shape[2])};
+     }
+ };
+
+ /**
+  * @class BrickVolumeWriter
+  * @brief Creates a brick volume and appends compressed bricks to it.
+  *
+  * Bricks may be written in any order; bricks that are never written read back as zeros.
+  * The index is written by close() (or by the destructor).
+  *
+  * @tparam T The voxel type.
+  */
+ template<typename T>
+ class BrickVolumeWriter {
+ public:
+     /**
+      * @brief Creates `<base>.bricks` and `<base>.bidx`.
+      * @param base_path The path of the volume without extension.
+      * @param shape The volume shape (depth, height, width).
+      * @param brick_shape The brick shape (depth, height, width).
+      * @param compression The brick compression scheme (must be available in-process).
+      * @param level The codec level (negative selects the codec default).
+      */
+     BrickVolumeWriter(const std::string& base_path, const std::array<size_t, 3>& shape,
+                       const std::array<size_t, 3>& brick_shape = {64, 64, 64},
+                       Compression compression = Compression::Deflate, int level = -1);
+     ~BrickVolumeWriter();
+     BrickVolumeWriter(const BrickVolumeWriter&) = delete;
+     BrickVolumeWriter& operator=(const BrickVolumeWriter&) = delete;
+
+     /// @brief Returns the geometry of the volume being written.
+     const BrickVolumeInfo& info() const { return info_; }
+
+     /**
+      * @brief Compresses and stores one brick.
+      * @param bz The brick coordinate along depth.
+      * @param by The brick coordinate along height.
+      * @param bx The brick coordinate along width.
+      * @param brick The brick voxels; its shape must equal info().brick_extent(bz, by, bx).
+      */
+     void write_brick(size_t bz, size_t by, size_t bx, const xt::xtensor<T, 3>& brick);
+
+     /**
+      * @brief Stores every brick intersecting a block of whole slices.
+      *
+      * The slab must start on a brick boundary along depth and cover either a whole
+      * brick layer or the end of the volume. Bricks are compressed in parallel.
+      *
+      * @param z_begin The first slice of the slab (a multiple of the brick depth).
+      * @param slab The slab voxels, of shape (slices, height, width).
+      * @param num_threads The number of compression threads (0 uses one per hardware core).
+      */
+     void write_slab(size_t z_begin, const xt::xtensor<T, 3>& slab, unsigned num_threads = 0);
+
+     /// @brief Writes the index and closes both files.
+     void close();
+
+ private:
+     void store_block(size_t index, const std::vector<unsigned char>& block);
+
+     std::string base_path_;
+     BrickVolumeInfo info_;
+     int level_;
+     std::vector<uint64_t> offsets_;
+     std::vector<uint64_t> sizes_;
+     uint64_t data_size_ = 0;
+     std::FILE* data_ = nullptr;
+ };
+
+ /**
+  * @class BrickVolumeReader
+  * @brief Random-access reader for brick volumes.
+  *
+  * Reads use positioned I/O on a shared file descriptor, so one reader can be used
+  * from several threads at once.
+  *
+  * @tparam T The voxel type.
+  */
+ template<typename T>
+ class BrickVolumeReader {
+ public:
+     /**
+      * @brief Opens `<base>.bidx` and `<base>.bricks`.
+      * @param base_path The path of the volume without extension.
+      */
+     explicit BrickVolumeReader(const std::string& base_path);
+     ~BrickVolumeReader();
+     BrickVolumeReader(const BrickVolumeReader&) = delete;
+     BrickVolumeReader& operator=(const BrickVolumeReader&) = delete;
+
+     /// @brief Returns the geometry of the volume.
+     const BrickVolumeInfo& info() const { return info_; }
+
+     /**
+      * @brief Reads and decompresses one brick.
+      * @return The brick voxels, of shape info().brick_extent(bz, by, bx).
+      */
+     xt::xtensor<T, 3> read_brick(size_t bz, size_t by, size_t bx) const;
+
+     /**
+      * @brief Reads the axis-aligned region [begin, end) of the volume.
+      *
+      * Only the bricks intersecting the region are decompressed, in parallel.
+      *
+      * @param begin The first voxel (z, y, x) of the region.
+      * @param end One past the last voxel (z, y, x) of the region.
+      * @param num_threads The number of decompression threads (0 uses one per hardware core).
+      * @return The region voxels, of shape end - begin.
+      */
+     xt::xtensor<T, 3> read_region(const std::array<size_t, 3>& begin, const std::array<size_t, 3>& end,
+                                   unsigned num_threads = 0) const;
+
+     /// @brief Reads the whole volume into memory.
+     xt::xtensor<T, 3> read_volume(unsigned num_threads = 0) const;
+
+ private:
+     void read_brick_into(size_t bz, size_t by, size_t bx, T* dest) const;
+
+     std::string base_path_;
+     BrickVolumeInfo info_;
+     std::vector<uint64_t> offsets_;
+     std::vector<uint64_t> sizes_;
+     int fd_ = -1;
+ };
+
+ /**
+  * @brief Converts an in-memory volume to a brick volume.
+  * @param image The volume to store.
+  * @param base_path The path of the volume without extension.
+  * @param brick_shape The brick shape (depth, height, width).
+  * @param compression The brick compression scheme.
+  * @param num_threads The number of compression threads (0 uses one per hardware core).
+  */
+ template<typename T>
+ void write_brick_volume(const xt::xtensor<T, 3>& image, const std::string& base_path,
+                         const std::array<size_t, 3>& brick_shape = {64, 64, 64},
+                         Compression compression = Compression::Deflate, unsigned num_threads = 0);
+
+ #endif // BRICK_VOLUME_H
@@ -0,0 +1,51 @@
+/**
+ * @file Codec.h
+ * @brief Declares the block compression codecs shared by the volume writers.
+ *
+ * The codecs compress independent buffers (TIFF strips, volume bricks) so that
+ * callers can run them on many threads at once and only serialize the final writes.
+ */
+
+ #ifndef CODEC_H
+ #define CODEC_H
+
+ #include <cstddef>
+ #include <vector>
+
+ /**
+  * @brief Compression schemes supported by the volume writers.
+  */
+ enum class Compression {
+     None,    ///< Stored as-is.
+     LZW,     ///< TIFF LZW (encoded by libtiff, TIFF output only).
+     Deflate, ///< zlib/deflate stream (TIFF "Adobe Deflate").
+     Zstd     ///< Zstandard frame (requires the project to be built with GRAIN_HAVE_ZSTD).
+ };
+
+ /**
+  * @brief Returns true if buffers can be compressed in-process with the given scheme.
+  * @param compression The compression scheme.
+  */
+ bool codec_is_available(Compression compression);
+
+ /**
+  * @brief Compresses a buffer into a self-contained block.
+  * @param data The bytes to compress.
+  * @param size The number of bytes to compress.
+  * @param compression The compression scheme (must be available in-process).
+  * @param level The codec level; a negative value selects the codec default.
+  * @return The compressed bytes (a plain copy for Compression::None).
+  */
+ std::vector<unsigned char> compress_buffer(const void* data, size_t size, Compression compression, int level = -1);
+ 
+ /**
+  * @brief Decompresses a block produced by compress_buffer.
+  * @param src The compressed bytes.
+  * @param src_size The number of compressed bytes.
+  * @param dst The destination buffer.
+  * @param dst_size The exact size of the decompressed data in bytes.
+  * @param compression The compression scheme used to produce the block.
+  */
+ void decompress_buffer(const unsigned char* src, size_t src_size, void* dst, size_t dst_size, Compression compression);
+
+ #endif // CODEC_H
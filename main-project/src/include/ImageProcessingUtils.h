@@ -11,42 +11,319 @@
  #define IMAGE_PROCESSING_UTILS_H
  
  #include <string>
+ #include <vector>
+ #include <cstdint>
+ #include <cmath>
+ #include <limits>
+ #include <type_traits>
  #include "xtensor/xtensor.hpp"
+ #include "Codec.h"
+ #include "volume.hpp"
+ #include "centroid.hpp"
+ 
+ /**
+  * @brief Byte offsets of every image file directory (IFD) of a multi-page TIFF.
+  *
+  * With the offsets known, any slice can be reached with a single TIFFSetSubDirectory
+  * seek instead of walking the IFD chain from the first directory.
+  */
+ struct TiffDirectoryIndex {
+     std::vector<uint64_t> offsets; ///< Offset of the IFD of each slice, in slice order.
+     uint32_t width = 0;            ///< Width of the first slice.
+     uint32_t height = 0;           ///< Height of the first slice.
+     uint16_t bits_per_sample = 0;  ///< Bits per sample of the first slice.
+ 
+     /// @brief Returns the number of slices (directories) in the file.
+     size_t depth() const { return offsets.size(); }
+ };
+ 
+ /**
+  * @brief Builds a directory index by walking the IFD chain of a TIFF file once.
+  * @param filepath The path to the TIFF file.
+  * @return The directory index of the file.
+  */
+ TiffDirectoryIndex build_tiff_directory_index(const std::string& filepath);
+ 
+ /**
+  * @brief Returns the directory index of a TIFF file, reusing a valid sidecar if present.
+  *
+  * The sidecar lives next to the TIFF (see tiff_index_sidecar_path) and records the size
+  * and modification time of the file it describes; a stale sidecar is ignored and rebuilt.
+  *
+  * @param filepath The path to the TIFF file.
+  * @param write_sidecar If true, a freshly built index is saved as a sidecar file.
+  * @return The directory index of the file.
+  */
+ TiffDirectoryIndex load_tiff_directory_index(const std::string& filepath, bool write_sidecar = false);
+ 
+ /**
+  * @brief Saves a directory index as a sidecar file next to the TIFF file.
+  * @param index The index to save.
+  * @param filepath The path to the TIFF file the index describes.
+  */
+ void save_tiff_directory_index(const TiffDirectoryIndex& index, const std::string& filepath);
+ 
+ /**
+  * @brief Returns the path of the sidecar index file for a TIFF file ("<file>.ifdx").
+  * @param filepath The path to the TIFF file.
+  */
+ std::string tiff_index_sidecar_path(const std::string& filepath);
+ 
+ /**
+  * @brief A per-voxel conversion applied while a TIFF is decoded.
+  *
+  * Converting strip by strip during decoding means only the converted volume is ever
+  * allocated (e.g. an 8-bit copy of a 16-bit scan). Results are rounded and clamped
+  * to the range of the output type.
+  */
+ struct VoxelTransform {
+     enum class Kind {
+         Identity,   ///< v
+         Shift,      ///< v >> a (a = 8 maps 16-bit data to 8 bits like `v / 256`)
+         Scale,      ///< v * a + b
+         Threshold,  ///< v >= a ? b : 0
+         WindowLevel ///< [a, b] stretched linearly to [0, c]
+     };
+ 
+     Kind kind = Kind::Identity;
+     double a = 0, b = 0, c = 0;
+ 
+     static VoxelTransform identity() { return {}; }
+     static VoxelTransform shift(int bits) { return {Kind::Shift, double(bits)}; }
+     static VoxelTransform scale(double factor, double offset = 0) { return {Kind::Scale, factor, offset}; }
+     static VoxelTransform threshold(double level, double value = 255) { return {Kind::Threshold, level, value}; }
+     static VoxelTransform window(double low, double high, double out_max = 255) { return {Kind::WindowLevel, low, high, out_max}; }
+ 
+     /**
+      * @brief Applies the transform to one sample value.
+      * @tparam Tout The output voxel type, whose range the result is clamped to.
+      */
+     template<typename Tout>
+     Tout apply(double v) const {
+         double r = v;
+         switch (kind) {
+             case Kind::Identity:    break;
+             case Kind::Shift:       r = std::floor(std::ldexp(v, -int(a))); break;
+             case Kind::Scale:       r = v * a + b; break;
+             case Kind::Threshold:   r = v >= a ? b : 0; break;
+             case Kind::WindowLevel: r = b > a ? (v - a) / (b - a) * c : (v >= a ? c : 0); break;
+         }
+         if (std::is_integral<Tout>::value) r = std::round(r);
+         r = std::min<double>(std::max<double>(r, std::numeric_limits<Tout>::lowest()), std::numeric_limits<Tout>::max());
+         return static_cast<Tout>(r);
+     }
+ };
+ 
+ /**
+  * @brief Reads the slices [z_begin, z_end) of a 3D grayscale TIFF file using a directory index.
+  * @tparam T The data type of the pixels (e.g., uint8_t, uint16_t).
+  * @param filepath The path to the TIFF file.
+  * @param index The directory index of the file.
+  * @param z_begin The first slice to read.
+  * @param z_end One past the last slice to read.
+  * @param num_threads The number of decoding threads (0 uses one per hardware core).
+  * @return An xt::xtensor<T, 3> of shape (z_end - z_begin, height, width).
+  */
+ template<typename T>
+ xt::xtensor<T, 3> read_tiff_slices_xt(const std::string& filepath, const TiffDirectoryIndex& index,
+                                       size_t z_begin, size_t z_end, unsigned num_threads = 0);
  
  /**
   * @brief Reads a 3D grayscale TIFF file into a 3D xtensor array.
+  *
+  * Directories are decoded in parallel: each worker opens its own TIFF handle and
+  * decodes a contiguous range of slices strip by strip (or tile by tile) directly
+  * into the returned tensor. Samples with a smaller bit depth than T are widened.
+  *
   * @tparam T The data type of the pixels (e.g., uint8_t, uint16_t).
   * @param filepath The path to the TIFF file.
-  * @return An xt::xtensor<T, 3> containing the image data.
+  * @param num_threads The number of decoding threads (0 uses one per hardware core).
+  * @return An xt::xtensor<T, 3> of shape (depth, height, width) containing the image data.
+  */
+ template<typename T>
+ xt::xtensor<T, 3> read_tiff_image_xt(const std::string& filepath, unsigned num_threads = 0);
+ 
+ /**
+  * @brief Reads the slices [z_begin, z_end) of a 3D grayscale TIFF file, converting every voxel on the fly.
+  *
+  * Each strip (or tile) is decoded into a small per-thread buffer and converted straight
+  * into the returned tensor, so the slices are never held at the file's bit depth.
+  *
+  * @tparam T The data type of the converted voxels.
+  * @param filepath The path to the TIFF file.
+  * @param index The directory index of the file.
+  * @param z_begin The first slice to read.
+  * @param z_end One past the last slice to read.
+  * @param transform The conversion applied to every stored sample value.
+  * @param num_threads The number of decoding threads (0 uses one per hardware core).
+  * @return An xt::xtensor<T, 3> of shape (z_end - z_begin, height, width).
   */
  template<typename T>
- xt::xtensor<T, 3> read_tiff_image_xt(const std::string& filepath);
+ xt::xtensor<T, 3> read_tiff_slices_xt(const std::string& filepath, const TiffDirectoryIndex& index,
+                                       size_t z_begin, size_t z_end, const VoxelTransform& transform,
+                                       unsigned num_threads = 0);
+ 
+ /**
+  * @brief Reads a 3D grayscale TIFF file, converting every voxel on the fly.
+  *
+  * For instance `read_tiff_image_xt<uint8_t>(path, VoxelTransform::shift(8))` loads a
+  * 16-bit scan as 8 bits without ever allocating the 16-bit volume.
+  *
+  * @tparam T The data type of the converted voxels.
+  * @param filepath The path to the TIFF file.
+  * @param transform The conversion applied to every stored sample value.
+  * @param num_threads The number of decoding threads (0 uses one per hardware core).
+  * @return An xt::xtensor<T, 3> of shape (depth, height, width) containing the converted data.
+  */
+ template<typename T>
+ xt::xtensor<T, 3> read_tiff_image_xt(const std::string& filepath, const VoxelTransform& transform,
+                                      unsigned num_threads = 0);
+ 
+ /**
+  * @brief Options controlling how 3D TIFF files are written.
+  */
+ struct TiffWriteOptions {
+     Compression compression = Compression::None; ///< Strip compression scheme.
+     int level = -1;                              ///< Codec level (negative selects the codec default).
+     uint32_t rows_per_strip = 0;                 ///< Rows per strip (0 picks strips of about 256 KiB).
+     bool bigtiff = false;                        ///< Force BigTIFF (enabled automatically above ~4 GB or for an unknown depth).
+     unsigned num_threads = 0;                    ///< Compression threads (0 uses one per hardware core).
+     uint16_t samples_per_pixel = 1;              ///< 1 for grayscale, 3 for interleaved RGB.
+ };
+ 
+ /**
+  * @class TiffStackWriter
+  * @brief Writes a 3D grayscale TIFF one batch of slices at a time.
+  *
+  * Deflate and zstd strips are compressed in parallel on a pool of threads; only the
+  * ordered writes of the compressed strips to the file are serialized. LZW strips are
+  * encoded by libtiff on the calling thread.
+  *
+  * @tparam T The data type of the pixels.
+  */
+ template<typename T>
+ class TiffStackWriter {
+ public:
+     /**
+      * @brief Opens a TIFF file for writing.
+      * @param filepath The path for the output TIFF file.
+      * @param height The slice height.
+      * @param width The slice width.
+      * @param options The compression and layout options.
+      * @param expected_depth The expected number of slices, used to decide on BigTIFF (0 if unknown,
+      *        which writes BigTIFF).
+      */
+     TiffStackWriter(const std::string& filepath, size_t height, size_t width,
+                     const TiffWriteOptions& options = {}, size_t expected_depth = 0);
+     ~TiffStackWriter();
+     TiffStackWriter(const TiffStackWriter&) = delete;
+     TiffStackWriter& operator=(const TiffStackWriter&) = delete;
+ 
+     /**
+      * @brief Appends slices stored contiguously in (slice, row, column[, sample]) order.
+      * @param slices A pointer to the first voxel of the first slice.
+      * @param count The number of slices to append.
+      */
+     void append(const T* slices, size_t count);
+ 
+     /**
+      * @brief Appends every slice of a (depth, height, width) tensor.
+      * @param slices The slices to append.
+      */
+     void append(const xt::xtensor<T, 3>& slices);
+ 
+     /// @brief Flushes and closes the file. Called automatically on destruction.
+     void close();
+ 
+     /// @brief Returns the number of slices written so far.
+     size_t depth() const { return depth_; }
+ 
+ private:
+     void write_directory_fields();
+ 
+     std::string filepath_;
+     size_t height_, width_;
+     TiffWriteOptions options_;
+     uint32_t rows_per_strip_ = 0;
+     bool in_process_codec_ = false;
+     size_t depth_ = 0;
+     struct tiff* out_ = nullptr;
+ };
  
  /**
   * @brief Writes a 3D grayscale xtensor array to a TIFF file.
   * @tparam T The data type of the pixels.
   * @param image The xt::xtensor<T, 3> to be saved.
   * @param filepath The path for the output TIFF file.
+  * @param options The compression and layout options (uncompressed classic TIFF by default).
   */
  template<typename T>
- void write_tiff_image_xt(const xt::xtensor<T, 3>& image, const std::string& filepath);
+ void write_tiff_image_xt(const xt::xtensor<T, 3>& image, const std::string& filepath,
+                          const TiffWriteOptions& options = {});
+ 
+ /**
+  * @brief Writes a 3D RGB image of shape (depth, height, width, 3) to a TIFF file.
+  * @param image The interleaved RGB image to be saved.
+  * @param filepath The path for the output TIFF file.
+  * @param options The compression and layout options (samples_per_pixel is forced to 3).
+  */
+ void write_rgb_tiff_image_xt(const xt::xtensor<uint8_t, 4>& image, const std::string& filepath,
+                              TiffWriteOptions options = {});
  
  /**
   * @brief Performs 3D morphological dilation with a ball structuring element.
-  * @note This is a wrapper for a function from the PINK image processing library.
-  * @param image The input 8-bit 3D image.
+  * @note Uses the distance-transform dilation of morphology.hpp (replacing the PINK call),
+  * whose cost does not depend on the radius; use dilate_ball() to dilate a mask in place.
+  * @param image The input 8-bit 3D binary image (every non-zero voxel is foreground).
+  * @param radius The radius of the ball structuring element.
+  * @param num_threads The number of worker threads (0 uses one per hardware core).
+  * @return The dilated 3D image (255 on foreground voxels).
+  */
+ xt::xtensor<uint8_t, 3> dilate_with_ball(const xt::xtensor<uint8_t, 3>& image, float radius, unsigned num_threads = 0);
+ 
+ /**
+  * @brief Performs 3D morphological erosion with a ball structuring element.
+  * @note The dual of dilate_with_ball(); voxels outside the image do not erode it.
+  * @param image The input 8-bit 3D binary image (every non-zero voxel is foreground).
   * @param radius The radius of the ball structuring element.
-  * @return The dilated 3D image.
+  * @param num_threads The number of worker threads (0 uses one per hardware core).
+  * @return The eroded 3D image (255 on foreground voxels).
   */
- xt::xtensor<uint8_t, 3> dilate_with_ball(const xt::xtensor<uint8_t, 3>& image, float radius);
+ xt::xtensor<uint8_t, 3> erode_with_ball(const xt::xtensor<uint8_t, 3>& image, float radius, unsigned num_threads = 0);
  
  /**
   * @brief Finds and labels connected components in a 3D binary image.
-  * @note This is a wrapper for a function from the PINK image processing library.
+  * @note Uses the parallel union-find labeling of connected_components.hpp; components are
+  * numbered in the raster order of their first voxel, whatever the thread count.
   * @param image The input 8-bit 3D binary image.
   * @param num_components A reference to an integer that will store the total number of components found.
+  * @param connectivity The voxel connectivity: 6, 18 or 26 (the default, as skimage.measure.label).
+  * @param num_threads The number of worker threads (0 uses one per hardware core).
   * @return A 3D image with each component assigned a unique integer label.
   */
- xt::xtensor<uint32_t, 3> label_components(const xt::xtensor<uint8_t, 3>& image, int& num_components);
+ xt::xtensor<uint32_t, 3> label_components(const xt::xtensor<uint8_t, 3>& image, int& num_components,
+                                           int connectivity = 26, unsigned num_threads = 0);
+ 
+ /**
+  * @brief Computes the centroid of every label of a labeled image.
+  * @note The moments of all labels are accumulated in one pass (see region_moments.hpp);
+  * no per-voxel coordinates are stored.
+  * @param labels The labeled 3D image (0 is background).
+  * @param num_threads The number of worker threads (0 uses one per hardware core).
+  * @return One centroid per label present in the image, in increasing label order.
+  */
+ std::vector<Centroid> calculate_centroids(const xt::xtensor<uint32_t, 3>& labels, unsigned num_threads = 0);
+
+ /**
+  * @brief Computes the centroid of every label of a labeled volume, e.g. a borrowed MappedVolume.
+  */
+ std::vector<Centroid> calculate_centroids(const Volume<uint32_t>& labels, unsigned num_threads = 0);
+ 
+ /**
+  * @brief Writes centroids to a CSV file with the columns X, Y, Z and Label.
+  * @param filepath The path for the output CSV file.
+  * @param centroids The centroids to write.
+  */
+ void write_centroids_csv(const std::string& filepath, const std::vector<Centroid>& centroids);
  
  #endif // IMAGE_PROCESSING_UTILS_H
\ No newline at end of file
@@ -0,0 +1,129 @@
+/**
+ * @file MappedVolume.h
+ * @brief Declares a read-only 3D volume backed by a memory-mapped file.
+ *
+ * Uncompressed, contiguous TIFF stacks and the `.raw` files produced by `tiff2raw`
+ * already store voxels in the (depth, height, width) row-major order used by xtensor,
+ * so they can be exposed directly from the page cache instead of being copied.
+ */
+
+ #ifndef MAPPED_VOLUME_H
+ #define MAPPED_VOLUME_H
+
+ #include <array>
+ #include <cstddef>
+ #include <string>
+ #include "xtensor/xtensor.hpp"
+ #include "xtensor/xadapt.hpp"
+ #include "volume.hpp"
+
+ struct VoxelTransform;
+
+ /**
+  * @class MappedVolume
+  * @brief A read-only volume that maps its file into memory when the layout allows it.
+  *
+  * When the file cannot be mapped (compressed data, strips that are not laid out
+  * back to back, a bit depth or sample format different from T, foreign byte order, ...),
+  * the volume falls back to the regular copying reader and owns its data instead, so both
+  * paths accept the same files. In both cases `view()` returns a non-owning xtensor adaptor
+  * over the voxels.
+  *
+  * @tparam T The voxel type (uint8_t, uint16_t, int16_t or uint32_t).
+  */
+ template<typename T>
+ class MappedVolume {
+ public:
+     /**
+      * @brief Opens a 3D grayscale TIFF file, mapping it if it is uncompressed and contiguous.
+      * @param filepath The path to the TIFF file.
+      * @param num_threads The number of decoding threads used by the copying fallback.
+      * @return The opened volume.
+      */
+     static MappedVolume open_tiff(const std::string& filepath, unsigned num_threads = 0);
+
+     /**
+      * @brief Opens a 3D grayscale TIFF file, converting every voxel unless no conversion is needed.
+      *
+      * With the identity transform this is open_tiff(filepath, num_threads): the file is mapped
+      * when the layout allows it. Any other transform is applied while the file is decoded
+      * (see read_tiff_slices_xt), so only the converted volume is allocated.
+      *
+      * @param filepath The path to the TIFF file.
+      * @param transform The conversion applied to every stored sample value.
+      * @param num_threads The number of decoding threads.
+      * @return The opened volume.
+      */
+     static MappedVolume open_tiff(const std::string& filepath, const VoxelTransform& transform,
+                                   unsigned num_threads = 0);
+
+     /**
+      * @brief Maps a headerless raw volume, such as the files written by `tiff2raw`.
+      * @param filepath The path to the raw file.
+      * @param depth The number of slices.
+      * @param height The slice height.
+      * @param width The slice width.
+      * @param header_bytes The number of bytes to skip at the start of the file.
+      * @return The opened volume.
+      */
+     static MappedVolume open_raw(const std::string& filepath, size_t depth, size_t height, size_t width,
+                                  size_t header_bytes = 0);
+
+     MappedVolume() = default;
+     MappedVolume(MappedVolume&& other) noexcept;
+     MappedVolume& operator=(MappedVolume&& other) noexcept;
+     MappedVolume(const MappedVolume&) = delete;
+     MappedVolume& operator=(const MappedVolume&) = delete;
+     ~MappedVolume();
+
+     /// @brief Returns true if the voxels come straight from a file mapping.
+     bool is_mapped() const { return mapping_ != nullptr; }
+
+     /// @brief Returns a pointer to the first voxel.
+     const T* data() const { return data_; }
+
+     /// @brief Returns the (depth, height, width) shape of the volume.
+     const std::array<size_t, 3>& shape() const { return shape_; }
+
+     /// @brief Returns the total number of voxels.
+     size_t size() const { return shape_[0] * shape_[1] * shape_[2]; }
+
+     /**
+      * @brief Returns a zero-copy xtensor view over the voxels.
+      * @note The view is only valid while this MappedVolume is alive.
+      */
+     auto view() const { return xt::adapt(data_, size(), xt::no_ownership(), shape_); }
+
+ private:
+     void release();
+
+     void* mapping_ = nullptr;      ///< Start of the page-aligned mapping, if any.
+     size_t mapping_length_ = 0;    ///< Length of the mapping in bytes.
+     const T* data_ = nullptr;      ///< First voxel, inside the mapping or inside owned_.
+     std::array<size_t, 3> shape_{};
+     xt::xtensor<T, 3> owned_;      ///< Storage used by the copying fallback.
+ };
+
+ /**
+  * @brief Wraps a mapped (or decoded) volume as a Volume without copying, e.g. for the contact detectors.
+  * @note The MappedVolume must outlive the returned volume, which aliases read-only memory and
+  * must not be modified.
+  */
+ template<typename T>
+ const Volume<T> borrow_volume(const MappedVolume<T>& volume) {
+     const auto& shape = volume.shape();
+     return {VoxelBuffer<T>::borrow(const_cast<T*>(volume.data()), volume.size()),
+             long(shape[0]), long(shape[1]), long(shape[2])};
+ }
+
+ /// Non-const version, so that it is preferred over the generic borrow_volume() of volume_xtensor.hpp.
+ template<typename T>
+ const Volume<T> borrow_volume(MappedVolume<T>& volume) {
+     return borrow_volume(static_cast<const MappedVolume<T>&>(volume));
+ }
+
+ /// Temporaries would unmap the voxels before the volume that borrows them is used.
+ template<typename T>
+ void borrow_volume(const MappedVolume<T>&& volume) = delete;
+
+ #endif // MAPPED_VOLUME_H
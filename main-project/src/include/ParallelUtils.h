@@ -0,0 +1,101 @@
+/**
+ * @file ParallelUtils.h
+ * @brief Declares lightweight helpers for splitting work across threads.
+ *
+ * The helpers in this file are header-only and only depend on the standard
+ * library, so both the segmentation tools and the contact detection modules
+ * can use them without linking anything beyond Threads::Threads.
+ */
+
+ #ifndef PARALLEL_UTILS_H
+ #define PARALLEL_UTILS_H
+
+ #include <algorithm>
+ #include <cstddef>
+ #include <exception>
+ #include <thread>
+ #include <vector>
+
+ /**
+  * @brief Resolves the number of worker threads to use.
+  * @param requested The requested thread count (0 means "one per hardware core").
+  * @param work_items The number of independent work items, used as an upper bound.
+  * @return A thread count in the range [1, max(1, work_items)].
+  */
+ inline unsigned resolve_thread_count(unsigned requested, size_t work_items) {
+     unsigned n = requested;
+     if (n == 0) {
+         n = std::thread::hardware_concurrency();
+         if (n == 0) n = 1;
+     }
+     if (work_items > 0 && n > work_items) {
+         n = static_cast<unsigned>(work_items);
+     }
+     return std::max(1u, n);
+ }
+
+ /**
+  * @brief Splits the range [begin, end) into contiguous chunks and runs them in parallel.
+  *
+  * Each worker receives one contiguous sub-range and its worker index, so it can
+  * keep thread-local state (e.g. a file handle) for the whole chunk. The first
+  * exception thrown by a worker is rethrown on the calling thread once all
+  * workers have joined.
+  *
+  * @param begin The first index of the range.
+  * @param end One past the last index of the range.
+  * @param num_threads The requested thread count (0 means "one per hardware core").
+  * @param body A callable invoked as body(chunk_begin, chunk_end, worker_index).
+  */
+ template<typename Body>
+ void parallel_for_chunks(size_t begin, size_t end, unsigned num_threads, Body&& body) {
+     if (end <= begin) return;
+     const size_t count = end - begin;
+     const unsigned workers = resolve_thread_count(num_threads, count);
+
+     if (workers == 1) {
+         body(begin, end, 0u);
+         return;
+     }
+
+     std::vector<std::thread> threads;
+     std::vector<std::exception_ptr> errors(workers);
+     threads.reserve(workers);
+
+     // Distribute the remainder over the first chunks so sizes differ by at most one.
+     const size_t base = count / workers;
+     const size_t extra = count % workers;
+     size_t chunk_begin = begin;
+     for (unsigned w = 0; w < workers; ++w) {
+         size_t chunk_end = chunk_begin + base + (w < extra ? 1 : 0);
+         threads.emplace_back([&, chunk_begin, chunk_end, w]() {
+             try {
+                 body(chunk_begin, chunk_end, w);
+             } catch (...) {
+                 errors[w] = std::current_exception();
+             }
+         });
+         chunk_begin = chunk_end;
+     }
+
+     for (auto& t : threads) t.join();
+     for (auto& e : errors) {
+         if (e) std::rethrow_exception(e);
+     }
+ }
+
+ /**
+  * @brief Runs body(i) for every index in [begin, end) using parallel_for_chunks.
+  * @param begin The first index of the range.
+  * @param end One past the last index of the range.
+  * @param num_threads The requested thread count (0 means "one per hardware core").
+  * @param body A callable invoked as body(index).
+  */
+ template<typename Body>
+ void parallel_for(size_t begin, size_t end, unsigned num_threads, Body&& body) {
+     parallel_for_chunks(begin, end, num_threads, [&](size_t b, size_t e, unsigned) {
+         for (size_t i = b; i < e; ++i) body(i);
+     });
+ }
+
+ #endif // PARALLEL_UTILS_H
@@ -0,0 +1,337 @@
+/**
+ * @file SlabStream.h
+ * @brief Declares a z-slab streaming API for processing volumes larger than memory.
+ *
+ * A volume is streamed through a processing stage one slab of slices at a time. Each
+ * slab is loaded together with `halo` extra slices on both sides (clipped at the volume
+ * border), so stages that only look at a local neighbourhood produce exactly the same
+ * result as on the whole volume while only `slab + 2 * halo` slices are resident.
+ *
+ * Slabs are taken along the slowest axis of the data, i.e. along the directories of a
+ * TIFF stack (axis 0 of an xtensor, axis `i` of an Image3D).
+ */
+
+ #ifndef SLAB_STREAM_H
+ #define SLAB_STREAM_H
+
+ #include <algorithm>
+ #include <array>
+ #include <map>
+ #include <memory>
+ #include <string>
+ #include <utility>
+ #include <vector>
+ #include "xtensor/xtensor.hpp"
+ #include "ImageProcessingUtils.h"
+ #include "BrickVolume.h"
+
+ /**
+  * @brief The slices of one streaming step.
+  */
+ struct SlabWindow {
+     size_t z_begin = 0;    ///< First core slice (the slices this step is responsible for).
+     size_t z_end = 0;      ///< One past the last core slice.
+     size_t read_begin = 0; ///< First loaded slice (core minus halo, clipped to the volume).
+     size_t read_end = 0;   ///< One past the last loaded slice (core plus halo, clipped).
+
+     /// @brief Returns the number of halo slices loaded before the core.
+     size_t halo_before() const { return z_begin - read_begin; }
+
+     /// @brief Returns the number of core slices.
+     size_t core_depth() const { return z_end - z_begin; }
+ };
+
+ /**
+  * @brief Splits [0, depth) into consecutive slabs with a halo on both sides.
+  * @param depth The number of slices of the volume.
+  * @param slab The number of core slices per slab.
+  * @param halo The number of neighbouring slices loaded on each side of the core.
+  * @return The slab windows, in increasing z order.
+  */
+ inline std::vector<SlabWindow> slab_windows(size_t depth, size_t slab, size_t halo) {
+     std::vector<SlabWindow> windows;
+     slab = std::max<size_t>(1, slab);
+     for (size_t z = 0; z < depth; z += slab) {
+         SlabWindow w;
+         w.z_begin = z;
+         w.z_end = std::min(depth, z + slab);
+         w.read_begin = z > halo ? z - halo : 0;
+         w.read_end = std::min(depth, w.z_end + halo);
+         windows.push_back(w);
+     }
+     return windows;
+ }
+
+
+ // --- Sources ---
+
+ /**
+  * @brief A volume that can be read one range of slices at a time.
+  */
+ template<typename T>
+ class SlabSource {
+ public:
+     virtual ~SlabSource() = default;
+
+     /// @brief Returns the volume shape (depth, height, width).
+     virtual std::array<size_t, 3> shape() const = 0;
+
+     /// @brief Reads the slices [z_begin, z_end).
+     virtual xt::xtensor<T, 3> read(size_t z_begin, size_t z_end) const = 0;
+ };
+
+ /**
+  * @brief Streams slices from a multi-page TIFF using its directory index.
+  */
+ template<typename T>
+ class TiffSlabSource : public SlabSource<T> {
+ public:
+     explicit TiffSlabSource(const std::string& filepath, unsigned num_threads = 0)
+         : filepath_(filepath), index_(load_tiff_directory_index(filepath, true)), num_threads_(num_threads) {}
+
+     std::array<size_t, 3> shape() const override {
+         return {index_.depth(), size_t(index_.height), size_t(index_.width)};
+     }
+
+     xt::xtensor<T, 3> read(size_t z_begin, size_t z_end) const override {
+         return read_tiff_slices_xt<T>(filepath_, index_, z_begin, z_end, num_threads_);
+     }
+
+ private:
+     std::string filepath_;
+     TiffDirectoryIndex index_;
+     unsigned num_threads_;
+ };
+
+ /**
+  * @brief Streams slices from a brick volume.
+  */
+ template<typename T>
+ class BrickSlabSource : public SlabSource<T> {
+ public:
+     explicit BrickSlabSource(const std::string& base_path, unsigned num_threads = 0)
+         : reader_(base_path), num_threads_(num_threads) {}
+
+     std::array<size_t, 3> shape() const override { return reader_.info().shape; }
+
+     xt::xtensor<T, 3> read(size_t z_begin, size_t z_end) const override {
+         auto s = shape();
+         return reader_.read_region({z_begin, 0, 0}, {z_end, s[1], s[2]}, num_threads_);
+     }
+
+ private:
+     BrickVolumeReader<T> reader_;
+     unsigned num_threads_;
+ };
+
+ /**
+  * @brief Streams slices from a volume that is already in memory.
+  */
+ template<typename T>
+ class TensorSlabSource : public SlabSource<T> {
+ public:
+     explicit TensorSlabSource(const xt::xtensor<T, 3>& image) : image_(image) {}
+
+     std::array<size_t, 3> shape() const override {
+         return {image_.shape()[0], image_.shape()[1], image_.shape()[2]};
+     }
+
+     xt::xtensor<T, 3> read(size_t z_begin, size_t z_end) const override {
+         auto s = shape();
+         xt::xtensor<T, 3> out = xt::empty<T>({z_end - z_begin, s[1], s[2]});
+         const size_t slice_size = s[1] * s[2];
+         std::copy_n(image_.data() + z_begin * slice_size, out.size(), out.data());
+         return out;
+     }
+
+ private:
+     const xt::xtensor<T, 3>& image_;
+ };
+
+
+ // --- Sinks ---
+
+ /**
+  * @brief Receives the core slices of each slab, in increasing z order.
+  */
+ template<typename T>
+ class SlabSink {
+ public:
+     virtual ~SlabSink() = default;
+
+     /// @brief Appends the next core slices.
+     virtual void write(const xt::xtensor<T, 3>& slices) = 0;
+
+     /// @brief Flushes the sink once the last slab has been written.
+     virtual void finish() {}
+ };
+
+ /**
+  * @brief Appends slabs to a TIFF file.
+  */
+ template<typename T>
+ class TiffSlabSink : public SlabSink<T> {
+ public:
+     TiffSlabSink(const std::string& filepath, const std::array<size_t, 3>& shape, const TiffWriteOptions& options = {})
+         : writer_(filepath, shape[1], shape[2], options, shape[0]) {}
+
+     void write(const xt::xtensor<T, 3>& slices) override { writer_.append(slices); }
+     void finish() override { writer_.close(); }
+
+ private:
+     TiffStackWriter<T> writer_;
+ };
+
+ /**
+  * @brief Appends slabs to a brick volume, buffering slices until a brick layer is complete.
+  */
+ template<typename T>
+ class BrickSlabSink : public SlabSink<T> {
+ public:
+     BrickSlabSink(const std::string& base_path, const std::array<size_t, 3>& shape,
+                   const std::array<size_t, 3>& brick_shape = {64, 64, 64},
+                   Compression compression = Compression::Deflate, unsigned num_threads = 0)
+         : writer_(base_path, shape, brick_shape, compression), num_threads_(num_threads) {}
+
+     void write(const xt::xtensor<T, 3>& slices) override;
+     void finish() override;
+
+ private:
+     void flush_layers(bool final);
+
+     BrickVolumeWriter<T> writer_;
+     unsigned num_threads_;
+     std::vector<T> pending_;     ///< Slices received but not yet stored as bricks.
+     size_t pending_begin_ = 0;   ///< z of the first pending slice.
+ };
+
+ /**
+  * @brief Collects slabs into an in-memory volume.
+  */
+ template<typename T>
+ class TensorSlabSink : public SlabSink<T> {
+ public:
+     explicit TensorSlabSink(const std::array<size_t, 3>& shape) : image_(xt::empty<T>({shape[0], shape[1], shape[2]})) {}
+
+     void write(const xt::xtensor<T, 3>& slices) override {
+         std::copy_n(slices.data(), slices.size(), image_.data() + written_);
+         written_ += slices.size();
+     }
+
+     /// @brief Returns the collected volume.
+     xt::xtensor<T, 3>& image() { return image_; }
+
+ private:
+     xt::xtensor<T, 3> image_;
+     size_t written_ = 0;
+ };
+
+
+ // --- Engine ---
+
+ /**
+  * @brief Streams a volume through a slab-local stage into a sink.
+  *
+  * For every window, `stage(input, window, output)` receives the loaded slices
+  * (core plus halo) and must fill `output`, which has the shape of the core slices.
+  *
+  * @param source The input volume.
+  * @param sink The output volume; finish() is called after the last slab.
+  * @param slab The number of core slices per slab.
+  * @param halo The number of neighbouring slices the stage needs on each side.
+  * @param stage The slab-local computation.
+  */
+ template<typename Tin, typename Tout, typename Stage>
+ void stream_slabs(const SlabSource<Tin>& source, SlabSink<Tout>& sink, size_t slab, size_t halo, Stage&& stage) {
+     auto shape = source.shape();
+     for (const auto& window : slab_windows(shape[0], slab, halo)) {
+         xt::xtensor<Tin, 3> input = source.read(window.read_begin, window.read_end);
+         xt::xtensor<Tout, 3> output = xt::empty<Tout>({window.core_depth(), shape[1], shape[2]});
+         stage(static_cast<const xt::xtensor<Tin, 3>&>(input), window, output);
+         sink.write(output);
+     }
+     sink.finish();
+ }
+
+ /**
+  * @brief Visits a volume slab by slab, for stages that reduce instead of producing a volume.
+  * @param source The input volume.
+  * @param slab The number of core slices per slab.
+  * @param halo The number of neighbouring slices loaded on each side of the core.
+  * @param visit A callable invoked as visit(input, window).
+  */
+ template<typename T, typename Visitor>
+ void for_each_slab(const SlabSource<T>& source, size_t slab, size_t halo, Visitor&& visit) {
+     for (const auto& window : slab_windows(source.shape()[0], slab, halo)) {
+         xt::xtensor<T, 3> input = source.read(window.read_begin, window.read_end);
+         visit(static_cast<const xt::xtensor<T, 3>&>(input), window);
+     }
+ }
+
+
+ // --- Streaming Stages ---
+
+ /**
+  * @brief Streaming version of run_tiff_binarization: voxels >= threshold become 255, others 0.
+  */
+ template<typename T>
+ void stream_binarization(const SlabSource<T>& source, SlabSink<uint8_t>& sink, int threshold, size_t slab = 64);
+
+ /**
+  * @brief Streaming version of run_tiff_binary_sum: 255 where either input is >= 255, 0 elsewhere.
+  */
+ template<typename T>
+ void stream_binary_sum(const SlabSource<T>& first, const SlabSource<T>& second, SlabSink<uint8_t>& sink, size_t slab = 64);
+
+ /**
+  * @brief Streaming version of erosion() from common.hpp (one 6-neighbour step, halo of one slice).
+  */
+ void stream_erosion(const SlabSource<uint32_t>& source, SlabSink<uint32_t>& sink, size_t slab = 64);
+
+ /**
+  * @brief Streaming version of the naive contact detection on a label volume.
+  *
+  * Contact strengths depend on erosions, which only look `strength - 1` voxels away,
+  * so every strength up to `halo + 1` is exact; stronger contacts are reported with
+  * strength `halo + 1` and a warning is printed.
+  *
+  * @param labels The label volume.
+  * @param slab The number of core slices per slab.
+  * @param halo The number of halo slices, bounding the measurable strength.
+  * @return The contact strength of every pair of touching labels (smaller label first).
+  */
+ std::map<std::pair<int, int>, int> stream_contact_detection_naive(const SlabSource<uint32_t>& labels,
+                                                                   size_t slab = 64, size_t halo = 16);
+
+ /**
+  * @brief Streaming version of label_components(): labels the connected components of the non-zero voxels.
+  *
+  * Neither the image nor its labels need to fit in memory. The first pass labels every slab
+  * on its own (label_connected_components()) and records only the equivalences between the
+  * last slice of a slab and the first slice of the next one; they are resolved in a global
+  * union-find over the per-slab components. The second pass labels every slab again and
+  * writes the global labels. The output is identical to label_components() on the whole
+  * volume, numbering included (raster order of each component's first voxel).
+  *
+  * @param image The binary image (read twice).
+  * @param sink The label volume.
+  * @param connectivity The voxel connectivity: 6, 18 or 26.
+  * @param slab The number of slices per slab.
+  * @param num_threads The number of worker threads used within a slab (0 uses one per hardware core).
+  * @return The number of components.
+  */
+ template<typename T>
+ size_t stream_label_components(const SlabSource<T>& image, SlabSink<uint32_t>& sink, int connectivity = 26,
+                                size_t slab = 64, unsigned num_threads = 0);
+
+ /**
+  * @brief Streaming version of the colormap tool: writes a random RGB color per label (0 stays black).
+  * @param labels The label volume (read twice: once to collect labels, once to color them).
+  * @param output_path The path of the RGB TIFF to write.
+  * @param slab The number of slices per slab.
+  * @param options The TIFF output options.
+  */
+ void stream_colormap(const SlabSource<uint32_t>& labels, const std::string& output_path,
+                      size_t slab = 64, const TiffWriteOptions& options = {});
+
+ #endif // SLAB_STREAM_H
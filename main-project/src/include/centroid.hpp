@@ -0,0 +1,12 @@
+#pragma once
+
+/**
+ * @brief The centroid of one labeled region, as written to the centroid CSV files.
+ *
+ * Shared by the contact modules (compute_centroids()) and the segmentation tools
+ * (calculate_centroids()).
+ */
+struct Centroid {
+    int x, y, z; ///< The truncated mean coordinates (i, j, k) of the region.
+    int label;   ///< The label of the region (compute_centroids(): the label found at the centroid).
+};
@@ -1,48 +1,93 @@
 #pragma once
 
+#include <array>
+#include <cstdint>
 #include <vector>
 #include <string>
 #include <map>
 #include <utility>
 
+#include "volume.hpp"
+
 /**
- * @brief A simple container for 3D image data.
+ * @brief The labeled image type used by the contact detection modules.
  *
- * This struct stores voxel data in a flattened 1D vector for cache
- * efficiency and provides methods for easy 3D coordinate access.
+ * Image3D is the 32-bit signed instance of the typed Volume container; masks and
+ * skeletons can use Mask3D (8-bit) and labels Labels3D (32-bit unsigned) instead.
  */
-struct Image3D {
-    std::vector<int> data;
-    long x_dim = 0, y_dim = 0, z_dim = 0;
-
-    /**
-     * @brief Provides direct write access to a voxel at coordinates (i, j, k).
-     * @param i The x-coordinate (row).
-     * @param j The y-coordinate (column).
-     * @param k The z-coordinate (slice).
-     * @return A reference to the voxel value.
-     */
-    int& at(long i, long j, long k);
-
-    /**
-     * @brief Provides direct read-only access to a voxel at coordinates (i, j, k).
-     * @param i The x-coordinate (row).
-     * @param j The y-coordinate (column).
-     * @param k The z-coordinate (slice).
-     * @return A const reference to the voxel value.
-     */
-    const int& at(long i, long j, long k) const;
-};
+using Image3D = Volume<int>;
 
 /**
  * @brief Performs one step of morphological erosion on a 3D image.
  *
  * This function iterates through each non-zero voxel and sets it to zero
  * if any of its 6-connected neighbors has a value of zero.
- * @param grains The input Image3D object to be eroded.
- * @return A new Image3D object representing the eroded result.
+ * @tparam T The voxel type (instantiated for int, uint8_t, uint16_t and uint32_t).
+ * @param grains The input volume to be eroded.
+ * @return A new volume representing the eroded result.
+ */
+template<typename T>
+Volume<T> erosion(const Volume<T>& grains);
+
+/**
+ * @brief Performs one step of morphological erosion into a caller-provided volume.
+ *
+ * Same result as erosion(), but slabs of slices are eroded in parallel, the image borders
+ * need no per-voxel bounds checks and the rows are processed with vectorizable loops.
+ * Reusing `eroded` across calls (e.g. ping-ponging two volumes) avoids any allocation.
+ *
+ * @param grains The input volume to be eroded.
+ * @param eroded The output volume; it is reallocated only if its size differs from `grains`,
+ * and must not share its buffer with `grains`.
+ * @param num_threads The number of worker threads (0 uses one per hardware core).
+ */
+template<typename T>
+void erosion_into(const Volume<T>& grains, Volume<T>& eroded, unsigned num_threads = 0);
+
+/**
+ * @brief Repeated erosion() driven by a frontier of boundary voxels.
+ *
+ * Instead of rescanning the whole volume, each step only zeroes the voxels of the current
+ * frontier (the non-zero voxels touching the background) and collects the next frontier
+ * among their neighbors, so the cost of a step is proportional to the surface being peeled.
+ * The two frontier lists are swapped between steps and reused, and the volume is eroded in place.
+ *
+ * After `n` calls to step(), current() equals erosion() applied `n` times.
+ * @tparam T The voxel type (instantiated for int, uint8_t, uint16_t and uint32_t).
  */
-Image3D erosion(const Image3D& grains);
+template<typename T>
+class IncrementalErosion {
+public:
+    /**
+     * @brief Prepares the erosion of a volume (one full scan to find the first frontier).
+     * @param grains The volume to erode; it is taken over by the engine.
+     * @param num_threads The number of threads used for the initial scan (0 uses one per hardware core).
+     */
+    explicit IncrementalErosion(Volume<T> grains, unsigned num_threads = 0);
+
+    /**
+     * @brief Peels one layer.
+     * @return The flat indices of the voxels zeroed by this step, i.e. the voxels that were
+     * still present at this erosion level and are gone at the next one.
+     */
+    const std::vector<size_t>& step();
+
+    /// @brief Returns the eroded volume after the steps performed so far.
+    const Volume<T>& current() const { return current_; }
+
+    /// @brief Returns the number of steps performed so far.
+    int level() const { return level_; }
+
+    /// @brief Returns true once further steps cannot change the volume.
+    bool done() const { return frontier_.empty(); }
+
+private:
+    Volume<T> current_;
+    std::vector<size_t> frontier_;  ///< Voxels zeroed by the next step.
+    std::vector<size_t> removed_;   ///< Voxels zeroed by the last step.
+    std::vector<uint8_t> queued_;   ///< Marks voxels already in a frontier.
+    int level_ = 0;
+};
 
 /**
  * @brief Saves detected contacts and their strengths to a CSV file.
@@ -52,4 +97,32 @@ Image3D erosion(const Image3D& grains);
  * the value is the calculated contact strength.
  * @param outputPath The path, including filename, for the output CSV file.
  */
-void save_results(const std::map<std::pair<int, int>, int>& contactsStrength, const std::string& outputPath);
\ No newline at end of file
+void save_results(const std::map<std::pair<int, int>, int>& contactsStrength, const std::string& outputPath);
+
+/**
+ * @brief The fabric statistics of one contact between two grains.
+ */
+struct ContactStats {
+    int strength = 0;                     ///< The contact strength, as written by save_results().
+    uint64_t face_count = 0;              ///< Number of voxel faces shared by the two grains (interface area).
+    std::array<double, 3> centroid = {};  ///< Mean position (x, y, z) of the shared faces, in voxels.
+    std::array<double, 3> normal = {};    ///< Unit normal of the interface, pointing from Label1 to Label2.
+};
+
+/**
+ * @brief Extracts the contact strengths from a set of contact statistics.
+ * @param stats The statistics of each pair of grain labels.
+ * @return A map from each pair of grain labels to its contact strength.
+ */
+std::map<std::pair<int, int>, int> contact_strengths(const std::map<std::pair<int, int>, ContactStats>& stats);
+
+/**
+ * @brief Saves contacts with their full statistics to a CSV file.
+ *
+ * The output CSV has the columns "Label1", "Label2", "ContactStrength", "FaceCount",
+ * "CentroidX", "CentroidY", "CentroidZ", "NormalX", "NormalY" and "NormalZ"; the first
+ * three match the file written by save_results().
+ * @param stats The statistics of each pair of grain labels.
+ * @param outputPath The path, including filename, for the output CSV file.
+ */
+void save_contact_statistics(const std::map<std::pair<int, int>, ContactStats>& stats, const std::string& outputPath);
@@ -0,0 +1,67 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+#include "volume.hpp"
+
+/**
+ * @brief A union-find over consecutive provisional labels, in which the smallest label of a
+ * set is its root.
+ *
+ * Provisional labels are created in raster order, so the root of a set is the label of its
+ * first voxel, and compact() numbers the sets in the raster order of their first voxel.
+ */
+class LabelEquivalences {
+public:
+    /// @brief Creates `count` singleton labels 0..count-1.
+    explicit LabelEquivalences(size_t count = 0);
+
+    /// @brief Creates a new singleton label and returns it.
+    uint32_t add();
+
+    /// @brief Returns the root of a label's set, halving the path on the way.
+    uint32_t find(uint32_t label);
+
+    /// @brief Merges the sets of two labels and returns the new root (the smaller one).
+    uint32_t unite(uint32_t a, uint32_t b);
+
+    /**
+     * @brief Numbers the sets 0..n-1 in the order of their roots.
+     * @return The number of sets; afterwards set_of() gives the set of every label.
+     */
+    uint32_t compact();
+
+    /// @brief Returns the set of a label (only valid after compact()).
+    uint32_t set_of(uint32_t label) const { return parent_[label]; }
+
+    /// @brief Returns the number of labels.
+    size_t size() const { return parent_.size(); }
+
+private:
+    std::vector<uint32_t> parent_;
+};
+
+/**
+ * @brief Labels the connected components of the non-zero voxels of a volume.
+ *
+ * Two-pass union-find labeling, parallel over slabs of slices: each slab labels its voxels
+ * with its own equivalence table, the equivalences across slab faces are then collected
+ * in parallel (read-only, so no locking is needed) and resolved in one small global table,
+ * and a last parallel pass writes the final labels.
+ *
+ * Components are numbered 1..num_components in the raster order of their first voxel
+ * (the numbering of a breadth-first labeling scan), whatever the thread count.
+ *
+ * @param image The image; every non-zero voxel is foreground.
+ * @param connectivity The voxel connectivity: 6 (faces), 18 (faces and edges) or 26 (full).
+ * @param num_components Set to the number of components found.
+ * @param num_threads The number of worker threads (0 uses one per hardware core).
+ * @return The labels (0 on background voxels).
+ * @throws std::invalid_argument If the connectivity is not 6, 18 or 26, or the volume has
+ * more voxels than 32-bit labels can address.
+ */
+template<typename T>
+Labels3D label_connected_components(const Volume<T>& image, int connectivity, size_t& num_components,
+                                    unsigned num_threads = 0);
@@ -6,10 +6,17 @@
  * @brief Executes the full pipeline for contact detection using the "extending labels" method.
  *
  * This function orchestrates a multi-step process that includes:
- * 1. Calling external scripts and tools (Python, Pink) to pre-process image data.
- * 2. Loading the resulting images (grains, skeleton, minTree) and centroid data.
- * 3. Running an iterative algorithm that propagates labels outwards from grain cores.
- * 4. Detecting contacts where propagation fronts meet and eroding the image to measure contact strength.
+ * 1. Loading the grains scan and pre-processing it in memory: min-tree core extraction,
+ *    binarization, binary sum with the cores and core labeling. The steps form a StageGraph,
+ *    so independent branches (e.g. the core labeling and the binarization) run concurrently.
+ * 2. Seeding each grain with its whole core: the 6-connected components of the min-tree cores.
+ * 3. Propagating all grain labels outwards from the cores at once, from the most eroded grains
+ *    down to the grains themselves (see contact_strength_by_propagation()). Each erosion level
+ *    grows the labels of the level above into the voxels it admits, so every voxel is claimed once.
+ * 4. Detecting contacts where propagation fronts meet; a contact's strength is the last erosion
+ *    level at which its fronts still meet.
  * 5. Saving the final contact strength map to a CSV file.
+ *
+ * @param num_threads The number of worker threads (0 uses one per hardware core, 1 runs serially).
  */
-void run_contact_detection_by_extending_labels();
\ No newline at end of file
+void run_contact_detection_by_extending_labels(unsigned num_threads = 0);
\ No newline at end of file
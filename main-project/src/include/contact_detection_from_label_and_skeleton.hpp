@@ -5,9 +5,18 @@
 /**
  * @brief Executes the contact detection pipeline using a pre-labeled image and a skeleton.
  *
- * This method orchestrates external tools to generate a skeleton from the input images.
- * It then iteratively checks for contacts only on the skeleton voxels, which significantly
- * reduces the search space compared to a naive full-image scan. At each iteration,
- * the labeled image is eroded to measure the strength of the detected contacts.
+ * This method orchestrates external tools to binarize the grains and extract their min-tree
+ * cores, then skeletonizes the grains in process (see skeletonize()). It checks for contacts
+ * only on the skeleton voxels, which significantly reduces the search space compared to a
+ * naive full-image scan. The strength of each contact (the number of erosions it survives)
+ * is read from a single distance transform of the labeled image (see
+ * contact_strength_on_skeleton()); only the voxels of the skeleton, loaded once into a
+ * SkeletonIndex, are visited.
+ *
+ * The distance transform is split into slabs of slices and the skeleton voxels into ranges,
+ * processed by `num_threads` threads that collect contacts in their own buffers; the buffers
+ * are merged deterministically, so the result is the same for any thread count.
+ *
+ * @param num_threads The number of worker threads (0 uses one per hardware core, 1 runs serially).
  */
-void run_contact_detection_from_label_and_skeleton();
\ No newline at end of file
+void run_contact_detection_from_label_and_skeleton(unsigned num_threads = 0);
\ No newline at end of file
@@ -5,9 +5,17 @@
 /**
  * @brief Executes a "naive" contact detection algorithm by performing a full-image scan.
  *
- * This method iteratively checks every non-background voxel for neighbors with different labels.
- * After each full scan that finds contacts, the image is eroded, and the process is repeated.
- * The number of erosion steps required to separate two grains defines their contact strength.
- * This approach is simple but computationally intensive.
+ * Every non-background voxel is checked for neighbors with different labels.
+ * The number of erosion steps required to separate two grains defines their contact strength;
+ * it is read from a single distance transform instead of eroding the image repeatedly
+ * (see contact_strength_naive()). The same sweep measures the interface area, centroid
+ * and normal of every contact, which are saved alongside in an extended CSV
+ * (see save_contact_statistics()).
+ *
+ * The volume is split into slabs of slices processed by `num_threads` threads, each
+ * reading a one-slice halo from its neighbor and collecting contacts in its own buffer;
+ * the buffers are merged deterministically, so the result is the same for any thread count.
+ *
+ * @param num_threads The number of worker threads (0 uses one per hardware core, 1 runs serially).
  */
-void run_contact_detection_naive();
\ No newline at end of file
+void run_contact_detection_naive(unsigned num_threads = 0);
\ No newline at end of file
@@ -0,0 +1,145 @@
+#pragma once
+
+#include <cstdint>
+#include <map>
+#include <utility>
+#include <vector>
+
+#include "common.hpp"
+
+/**
+ * @brief Packs an ordered pair of labels into one 64-bit key (first label in the high bits).
+ */
+inline uint64_t pack_label_pair(int a, int b) {
+    return (uint64_t(static_cast<uint32_t>(a)) << 32) | static_cast<uint32_t>(b);
+}
+
+/**
+ * @brief Unpacks a key built by pack_label_pair().
+ */
+inline std::pair<int, int> unpack_label_pair(uint64_t key) {
+    return {static_cast<int>(static_cast<uint32_t>(key >> 32)), static_cast<int>(static_cast<uint32_t>(key))};
+}
+
+/**
+ * @brief A value measured for a pair of labels, as emitted by the interface sweeps.
+ */
+struct PairSample {
+    uint64_t key;   ///< The pair, packed with pack_label_pair().
+    uint32_t value; ///< The measured value (e.g. a contact strength).
+};
+
+/**
+ * @brief Sorts samples by key with an LSD radix sort (stable; byte passes shared by all keys are skipped).
+ * @param samples The samples to sort in place.
+ */
+void radix_sort_pair_samples(std::vector<PairSample>& samples);
+
+/**
+ * @brief Reduces samples to the largest value of each pair.
+ * @param samples The samples; they are sorted in place.
+ * @return The largest value of each pair, keyed by the unpacked pair.
+ */
+std::map<std::pair<int, int>, int> reduce_pair_samples_max(std::vector<PairSample>& samples);
+
+/**
+ * @brief Computes the city-block (6-connected) distance of every voxel to the nearest background voxel.
+ *
+ * Background voxels get distance 0. The transform is exact and separable: one forward and
+ * one backward pass along each axis, with the lines of each pass split across threads.
+ * A voxel with distance d survives exactly d - 1 applications of erosion(), so this single
+ * transform replaces the erosion loops of the contact detectors.
+ *
+ * @param labels The labeled (or binary) volume; every non-zero voxel is foreground.
+ * @param num_threads The number of worker threads (0 uses one per hardware core).
+ * @return The distance volume. Without any background voxel, every distance is
+ * x_dim + y_dim + z_dim (larger than any distance inside the volume).
+ */
+template<typename T>
+Volume<uint32_t> city_block_distance(const Volume<T>& labels, unsigned num_threads = 0);
+
+/**
+ * @brief Computes the contact strengths of run_contact_detection_naive from one distance transform.
+ *
+ * A contact between labels A < B has strength s when some voxel of A touching B survives
+ * s - 1 erosions, i.e. the strength is the largest distance() of those interface voxels.
+ * Interface voxels are found in a single parallel sweep.
+ *
+ * @param labels The labeled volume.
+ * @param num_threads The number of worker threads (0 uses one per hardware core).
+ * @return The contact strength of every pair of touching labels (smaller label first).
+ */
+template<typename T>
+std::map<std::pair<int, int>, int> contact_strength_naive(const Volume<T>& labels, unsigned num_threads = 0);
+
+/**
+ * @brief Computes the contact strengths of run_contact_detection_from_label_and_skeleton.
+ *
+ * There, both the skeleton voxel and its neighbour are read from the eroded labels, so a
+ * contact lasts as long as the weaker of the two voxels: the strength is the largest
+ * min(distance(v), distance(n)) over skeleton voxels v of label A and neighbours n of label B > A.
+ *
+ * @param labels The labeled volume.
+ * @param skeleton The skeleton volume (non-zero on skeleton voxels), with the same dimensions.
+ * @param num_threads The number of worker threads (0 uses one per hardware core).
+ * @return The contact strength of every pair of touching labels (smaller label first).
+ */
+template<typename T, typename S>
+std::map<std::pair<int, int>, int> contact_strength_on_skeleton(const Volume<T>& labels, const Volume<S>& skeleton,
+                                                                unsigned num_threads = 0);
+
+/**
+ * @brief The voxels of a skeleton, stored as a compact list of linear indices.
+ *
+ * A skeleton is a tiny fraction of the volume, so the skeleton-guided detector visits this
+ * list instead of testing every voxel of a full skeleton volume.
+ */
+struct SkeletonIndex {
+    long x_dim = 0, y_dim = 0, z_dim = 0; ///< Dimensions of the volume the indices refer to.
+    std::vector<uint64_t> voxels;         ///< Linear indices, ascending (memory order) unless grouped by label.
+    std::vector<std::pair<int, size_t>> label_starts; ///< Set by group_skeleton_by_label(): (label, first position in `voxels`).
+
+    /// @brief Returns the number of skeleton voxels.
+    size_t size() const { return voxels.size(); }
+};
+
+/**
+ * @brief Collects the non-zero voxels of a skeleton volume, in memory order.
+ * @param skeleton The skeleton volume.
+ * @param num_threads The number of worker threads (0 uses one per hardware core).
+ * @return The skeleton index; the skeleton volume is no longer needed afterwards.
+ */
+template<typename S>
+SkeletonIndex build_skeleton_index(const Volume<S>& skeleton, unsigned num_threads = 0);
+
+/**
+ * @brief Reorders the skeleton voxels by label (memory order within a label) and fills `label_starts`.
+ * @param index The skeleton index to reorder.
+ * @param labels The labeled volume the skeleton belongs to.
+ */
+template<typename T>
+void group_skeleton_by_label(SkeletonIndex& index, const Volume<T>& labels);
+
+/**
+ * @brief Computes the same contact strengths as contact_strength_on_skeleton(), visiting only skeleton voxels.
+ * @param labels The labeled volume.
+ * @param skeleton The skeleton voxels, with the dimensions of `labels`.
+ * @param num_threads The number of worker threads (0 uses one per hardware core).
+ * @return The contact strength of every pair of touching labels (smaller label first).
+ */
+template<typename T>
+std::map<std::pair<int, int>, int> contact_strength_on_skeleton(const Volume<T>& labels, const SkeletonIndex& skeleton,
+                                                                unsigned num_threads = 0);
+
+/**
+ * @brief Computes the strength and the fabric statistics of every contact in one sweep.
+ *
+ * Alongside the strength of contact_strength_naive(), the sweep accumulates for each pair
+ * the number of shared voxel faces, their mean position and their summed orientation.
+ *
+ * @param labels The labeled volume.
+ * @param num_threads The number of worker threads (0 uses one per hardware core).
+ * @return The statistics of every pair of touching labels (smaller label first).
+ */
+template<typename T>
+std::map<std::pair<int, int>, ContactStats> contact_statistics(const Volume<T>& labels, unsigned num_threads = 0);
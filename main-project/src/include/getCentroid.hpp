@@ -1,6 +1,10 @@
 #pragma once
 
 #include <string>
+#include <vector>
+
+#include "common.hpp"
+#include "centroid.hpp"
 
 /**
  * @brief Calculates the centroids of connected components in a 3D image and saves them to a CSV file.
@@ -14,4 +18,14 @@
  * @param minTreePath The path to the input 3D TIFF image (e.g., a min-tree image) to be processed.
  * @param outputPath The path for the output CSV file where the centroid data will be saved.
  */
-void run_get_centroids(const std::string& grainsPath, const std::string& minTreePath, const std::string& outputPath);
\ No newline at end of file
+void run_get_centroids(const std::string& grainsPath, const std::string& minTreePath, const std::string& outputPath);
+
+/**
+ * @brief Labels the 6-connected components of an image in memory and computes their centroids.
+ * @param image The image; every voxel > 0 is foreground (e.g. the min-tree cores).
+ * @param num_threads The number of worker threads (0 uses one per hardware core).
+ * @return One centroid per component, in labeling order; the label of each centroid is the
+ * one found at its position (0 if it falls outside the component).
+ */
+template<typename T>
+std::vector<Centroid> compute_centroids(const Volume<T>& image, unsigned num_threads = 0);
@@ -27,6 +27,12 @@
      int label;          ///< Unique integer identifier for the grain.
      double x, y, z;     ///< The 3D coordinates of the grain's centroid.
      
+     // Morphometry, filled by GrainNetwork::load_morphometry() (0 until then).
+     double volume = 0.0;        ///< Volume in voxels.
+     double surface_area = 0.0;  ///< Estimated surface area, in squared voxels.
+     double sphericity = 0.0;    ///< 1 for a ball, lower for other shapes.
+     double axes[3] = {0, 0, 0}; ///< Semi-axes of the equivalent ellipsoid, major first.
+     
      /**
       * @brief Pointers to neighboring grains.
       * Pointers are used to efficiently represent the graph of contacts without
@@ -79,6 +85,17 @@
       */
      void load_contacts(const std::string& filepath);
  
+     /**
+      * @brief Loads per-grain morphometry from a grain report (see grain_report.hpp).
+      * @note Grains already loaded keep their tracked position; grains missing from the
+      * network are added at the centroid of the report.
+      * @param filepath The path to the report file. The file is expected to have a header
+      * line, followed by one line per grain with the columns Label, Volume, SurfaceArea,
+      * Sphericity, CentroidZ, CentroidY, CentroidX, Axis1, Axis2 and Axis3 (further
+      * columns are ignored).
+      */
+     void load_morphometry(const std::string& filepath);
+ 
      /**
       * @brief Classifies all grains into connected and unconnected sets.
       * A grain is considered connected if its list of neighbors is not empty.
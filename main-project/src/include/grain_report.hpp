@@ -0,0 +1,64 @@
+#pragma once
+
+#include <array>
+#include <cstdint>
+#include <string>
+#include <vector>
+
+#include "common.hpp"
+
+/**
+ * @brief The morphometry of one grain, as written by write_grain_report().
+ *
+ * Coordinates are (i, j, k) = (z, y, x) in voxels.
+ */
+struct GrainMorphometry {
+    uint32_t label = 0;                  ///< The grain label.
+    uint64_t volume = 0;                 ///< Number of voxels.
+    double surface_area = 0.0;           ///< Estimated surface area (2/3 of the boundary voxel faces).
+    double sphericity = 0.0;             ///< pi^(1/3) (6 V)^(2/3) / A: 1 for a ball, lower for other shapes.
+    std::array<double, 3> centroid{};    ///< The mean (i, j, k).
+    std::array<double, 3> axes{};        ///< Semi-axes of the ellipsoid with the same inertia, major first.
+    std::array<double, 3> major_axis{};  ///< Unit direction (i, j, k) of the major axis.
+    std::array<int, 3> bbox_min{};       ///< Smallest (i, j, k) of the bounding box.
+    std::array<int, 3> bbox_max{};       ///< Largest (i, j, k) of the bounding box, inclusive.
+};
+
+/**
+ * @brief Measures every grain of a label volume in a single parallel pass.
+ *
+ * The volume, bounding box, inertia tensor and boundary faces of all labels are gathered
+ * together by compute_region_moments(); the principal axes come from the eigenvalues of the
+ * coordinate covariance (plus 1/12 per axis for the extent of a voxel). Counting boundary
+ * faces overestimates the area of a smooth surface by 3/2 on average over orientations,
+ * which the surface area corrects for.
+ *
+ * @param labels The grain labels; voxels <= 0 are background.
+ * @param num_threads The number of worker threads (0 uses one per hardware core).
+ * @return One entry per label present in the volume, in increasing label order.
+ */
+template<typename T>
+std::vector<GrainMorphometry> compute_grain_report(const Volume<T>& labels, unsigned num_threads = 0);
+
+/**
+ * @brief Writes a grain report as a whitespace-separated table with a header line.
+ *
+ * Columns: Label Volume SurfaceArea Sphericity CentroidZ CentroidY CentroidX Axis1 Axis2
+ * Axis3 MajorZ MajorY MajorX MinZ MinY MinX MaxZ MaxY MaxX. GrainNetwork::load_morphometry()
+ * reads this format.
+ *
+ * @param outputPath The path of the report file.
+ * @param report The grains to write.
+ * @throws std::runtime_error If the file cannot be written.
+ */
+void write_grain_report(const std::string& outputPath, const std::vector<GrainMorphometry>& report);
+
+/**
+ * @brief Computes the morphometry of every grain of a labeled image and saves the report.
+ *
+ * Replaces the separate volume, surface, inertia and sphericity scripts with one pass.
+ *
+ * @param labelsPath The path to the labeled 3D TIFF image of one time step.
+ * @param outputPath The path for the report (see write_grain_report()).
+ */
+void run_grain_report(const std::string& labelsPath, const std::string& outputPath);
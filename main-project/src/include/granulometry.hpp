@@ -0,0 +1,72 @@
+#pragma once
+
+#include <cstdint>
+#include <string>
+#include <vector>
+
+#include "common.hpp"
+
+/**
+ * @brief The size measures of one grain of a binarized volume.
+ */
+struct GrainSize {
+    uint32_t label = 0;              ///< The grain label (connected component of the binary volume).
+    uint64_t volume = 0;             ///< Number of voxels.
+    double equivalent_radius = 0.0;  ///< Radius of the ball with the same volume, (3 V / 4 pi)^(1/3).
+    double inscribed_radius = 0.0;   ///< Radius of the largest ball inside the grain.
+    double mean_thickness = 0.0;     ///< Mean opening radius of the grain voxels.
+};
+
+/**
+ * @brief The outcome of compute_granulometry().
+ */
+struct Granulometry {
+    /// Squared radius of the largest inscribed ball that covers each voxel (0 on the background):
+    /// up to digitization, a voxel survives the opening by a ball of radius r when r^2 <= thickness.
+    Labels3D thickness;
+    /// spectrum[r] is the number of voxels whose opening radius lies in [r, r + 1) voxels, so the
+    /// volume of the opening by a ball of radius r is the sum of spectrum[r'] for r' >= r.
+    std::vector<uint64_t> spectrum;
+    std::vector<GrainSize> grains; ///< One entry per grain, in labeling order.
+};
+
+/**
+ * @brief Computes the granulometry of a binary volume from a single distance transform.
+ *
+ * Instead of one opening per radius, the opening spectrum is read from the opening transform
+ * (local thickness) of the volume: every voxel gets the largest ball, centered anywhere in the
+ * volume and lying inside the foreground, that covers it (the outside of the volume counts as
+ * background, so balls do not leave the field of view). The balls come from one
+ * squared_distance_transform(); only the maximal balls (those not contained in the ball of a
+ * neighbouring center) are propagated, painting the thickness row by row, in parallel over
+ * slabs of slices.
+ *
+ * @param binary The binary volume, e.g. the output of binarize(); every non-zero voxel is foreground.
+ * @param connectivity The connectivity of the grains (6, 18 or 26) for the per-grain measures.
+ * @param num_threads The number of worker threads (0 uses one per hardware core).
+ * @return The thickness map, the size histogram and the per-grain measures.
+ */
+template<typename T>
+Granulometry compute_granulometry(const Volume<T>& binary, int connectivity = 6, unsigned num_threads = 0);
+
+/**
+ * @brief Writes a granulometry as two CSV files.
+ *
+ * `<outputPrefix>_spectrum.csv` has the columns Radius, Voxels and OpeningVolume (the volume
+ * left by the opening of that radius); `<outputPrefix>_grains.csv` has the columns Label,
+ * Volume, EquivalentRadius, InscribedRadius and MeanThickness.
+ *
+ * @throws std::runtime_error If a file cannot be written.
+ */
+void write_granulometry(const std::string& outputPrefix, const Granulometry& granulometry);
+
+/**
+ * @brief Computes the grain size distribution of a binarized 3D TIFF image in one pass.
+ *
+ * Replaces the sweep of openings of increasing radius.
+ *
+ * @param inputFile The path to the binary 3D TIFF image (unsigned samples; every non-zero voxel
+ * is foreground).
+ * @param outputPrefix The prefix of the output CSV files (see write_granulometry()).
+ */
+void run_granulometry(const std::string& inputFile, const std::string& outputPrefix);
@@ -0,0 +1,62 @@
+#pragma once
+
+#include <cstdint>
+#include <map>
+#include <utility>
+#include <vector>
+
+#include "common.hpp"
+
+/**
+ * @brief The outcome of propagate_labels().
+ */
+struct LabelPropagation {
+    Labels3D labels;                          ///< The grown labels (0 outside the reached domain).
+    std::vector<std::pair<int, int>> contacts; ///< The pairs of labels whose fronts met (smaller label first, sorted).
+};
+
+/**
+ * @brief Grows every seed label through a domain at once, as a level-by-level 6-connected flood.
+ *
+ * The labels are kept in one dense volume (a voxel is visited when its label is non-zero)
+ * and each level of the flood is a flat frontier vector. The neighbours of a frontier are
+ * examined in parallel; a voxel reached by several labels in the same level takes the
+ * smallest one, so the result does not depend on the thread count. Two labels are in
+ * contact when a front reaches a voxel of the other label.
+ *
+ * @param seeds The seed labels (0 where there is no seed), with the dimensions of `domain`.
+ * @param domain The volume the labels may grow in: voxels whose value is at least `threshold`.
+ * Seeds outside the domain are ignored.
+ * @param threshold The smallest domain value a voxel must have to be reached.
+ * @param num_threads The number of worker threads (0 uses one per hardware core).
+ * @return The grown labels and the pairs of labels in contact.
+ * @throws std::invalid_argument If the dimensions do not match.
+ */
+template<typename T>
+LabelPropagation propagate_labels(const Labels3D& seeds, const Volume<T>& domain, T threshold = 1,
+                                  unsigned num_threads = 0);
+
+/**
+ * @brief Computes the contact strengths of the extending-labels detector.
+ *
+ * At erosion level n (n = 1 being the grains themselves), the labels cover the grains eroded
+ * n - 1 times, and every pair of fronts that meet is in contact. The eroded grains are read
+ * from a single city_block_distance() transform (level n keeps the voxels at distance >= n).
+ *
+ * The levels run from the most eroded grains down: the distances are kept as a 16-bit level
+ * map, each level collects the voxels it admits with one scan of that map, and grows the
+ * labels of the level above into them (the seeds among them start their own fronts). Every
+ * voxel is thus claimed once, and a pair in contact stays in contact at the levels below;
+ * the strength of a contact is the highest level at which its fronts meet (at most 65535).
+ * Besides the grains, this takes 6 bytes per voxel (level map and labels), plus the 4-byte
+ * distance transform while the level map is built.
+ *
+ * @param seeds The grain seeds (e.g. the labeled min-tree cores), with the dimensions of `grains`.
+ * @param grains The binary grains; every non-zero voxel is foreground.
+ * @param num_threads The number of worker threads (0 uses one per hardware core).
+ * @return The contact strength of every pair of grains whose fronts met (smaller label first).
+ * @throws std::invalid_argument If the dimensions do not match.
+ */
+template<typename T>
+std::map<std::pair<int, int>, int> contact_strength_by_propagation(const Labels3D& seeds, const Volume<T>& grains,
+                                                                   unsigned num_threads = 0);
@@ -2,6 +2,8 @@
 
 #include <string>
 
+#include "common.hpp"
+
 /**
  * @brief Creates and filters a component min-tree to segment image cores.
  *
@@ -15,4 +17,13 @@
  * @param adjacency The graph connectivity to use (e.g., 6 or 26).
  * @param outputFile The path for the output TIFF file.
  */
-void run_minTree(const std::string& inputFile, int adjacency, const std::string& outputFile);
\ No newline at end of file
+void run_minTree(const std::string& inputFile, int adjacency, const std::string& outputFile);
+
+/**
+ * @brief Extracts the grain cores of an 8-bit image in memory, with the filtering of run_minTree().
+ * @param image The 8-bit image (the scan reduced with v / 256, as `minTree.py` does).
+ * @param adjacency The graph connectivity, 6 or 26.
+ * @return The cores (255 inside a core, 0 elsewhere).
+ * @throws std::invalid_argument If the adjacency is neither 6 nor 26.
+ */
+Mask3D extract_min_tree_cores(const Mask3D& image, int adjacency);
@@ -0,0 +1,120 @@
+#pragma once
+
+#include "volume.hpp"
+
+/**
+ * @brief Computes the squared Euclidean distance of every voxel to the nearest background voxel.
+ *
+ * Exact transform made of three separable lower-envelope passes (one per axis, parallel over
+ * slabs), in time linear in the number of voxels. Background voxels get 0.
+ *
+ * @param mask The mask; every non-zero voxel is foreground.
+ * @param num_threads The number of worker threads (0 uses one per hardware core).
+ * @return The squared distances. Without any background voxel, every value is larger than any
+ * squared distance inside the volume.
+ */
+template<typename T>
+Volume<uint32_t> squared_distance_transform(const Volume<T>& mask, unsigned num_threads = 0);
+
+/**
+ * @brief Dilates a binary mask with a Euclidean ball, in place.
+ *
+ * A voxel becomes foreground when a foreground voxel lies within `radius` of it, i.e. the
+ * structuring element is every offset (di, dj, dk) with di^2 + dj^2 + dk^2 <= radius^2.
+ * The dilation thresholds an exact squared Euclidean distance transform, computed with three
+ * separable lower-envelope passes (one per axis, parallel over slabs), so its cost does not
+ * depend on the radius. The distances only matter up to radius^2, so they are clamped and,
+ * for radii below 16, stored in the mask itself; larger radii use a 32-bit buffer.
+ *
+ * @param mask The mask; every non-zero voxel is foreground. On return, voxels are 255 or 0.
+ * @param radius The ball radius in voxels.
+ * @param num_threads The number of worker threads (0 uses one per hardware core).
+ * @throws std::invalid_argument If the radius is negative.
+ */
+void dilate_ball(Mask3D& mask, double radius, unsigned num_threads = 0);
+
+/**
+ * @brief Erodes a binary mask with a Euclidean ball, in place.
+ *
+ * The dual of dilate_ball(): a foreground voxel is kept when no background voxel lies within
+ * `radius` of it. As with erosion(), the outside of the volume does not erode the mask.
+ *
+ * @param mask The mask; every non-zero voxel is foreground. On return, voxels are 255 or 0.
+ * @param radius The ball radius in voxels.
+ * @param num_threads The number of worker threads (0 uses one per hardware core).
+ * @throws std::invalid_argument If the radius is negative.
+ */
+void erode_ball(Mask3D& mask, double radius, unsigned num_threads = 0);
+
+/**
+ * @brief Dilates an image with a box structuring element of (2 ri + 1) x (2 rj + 1) x (2 rk + 1)
+ * voxels, in place.
+ *
+ * The box is decomposed into one line per axis, and every line is filtered with the van Herk /
+ * Gil-Werman algorithm: the line is cut into blocks of the window length, and the maximum of
+ * any window is the larger of a suffix maximum and a prefix maximum of two adjacent blocks.
+ * That costs three comparisons per voxel and axis whatever the radius. The lines of an axis
+ * are filtered in parallel over slabs. Voxels outside the volume are ignored.
+ *
+ * A radius of 0 leaves an axis untouched, so e.g. dilate_box(image, 0, 0, r) is a line along k.
+ *
+ * @param image The image (any voxel type with a total order).
+ * @param ri The radius along i.
+ * @param rj The radius along j.
+ * @param rk The radius along k.
+ * @param num_threads The number of worker threads (0 uses one per hardware core).
+ * @throws std::invalid_argument If a radius is negative.
+ */
+template<typename T>
+void dilate_box(Volume<T>& image, int ri, int rj, int rk, unsigned num_threads = 0);
+
+/**
+ * @brief Erodes an image with a box structuring element, in place (see dilate_box()).
+ */
+template<typename T>
+void erode_box(Volume<T>& image, int ri, int rj, int rk, unsigned num_threads = 0);
+
+/**
+ * @brief Opens an image with a box structuring element (erode_box() then dilate_box()), in place.
+ */
+template<typename T>
+void open_box(Volume<T>& image, int ri, int rj, int rk, unsigned num_threads = 0);
+
+/**
+ * @brief Closes an image with a box structuring element (dilate_box() then erode_box()), in place.
+ */
+template<typename T>
+void close_box(Volume<T>& image, int ri, int rj, int rk, unsigned num_threads = 0);
+
+/**
+ * @brief Reconstructs a marker by dilation under a mask (geodesic reconstruction), in place.
+ *
+ * Hybrid algorithm (Vincent, 1993): a forward raster scan and a backward scan propagate the
+ * marker through most of the volume, and the voxels that can still raise a neighbour seed a
+ * FIFO queue that finishes the propagation. The scans run in parallel over slabs of slices,
+ * each slab only looking at its own voxels; the voxels on the faces between slabs are then
+ * queued as well, so the sequential queue phase also settles what crosses the slabs.
+ *
+ * @param marker The marker; on return, its reconstruction (its geodesic dilations under the
+ * mask, repeated until stable). Marker values above the mask are lowered to the mask first.
+ * @param mask The mask, with the dimensions of `marker`.
+ * @param connectivity The voxel connectivity: 6, 18 or 26.
+ * @param num_threads The number of worker threads (0 uses one per hardware core).
+ * @throws std::invalid_argument If the dimensions do not match or the connectivity is not 6, 18 or 26.
+ */
+template<typename T>
+void reconstruct_by_dilation(Volume<T>& marker, const Volume<T>& mask, int connectivity = 6,
+                             unsigned num_threads = 0);
+
+/**
+ * @brief Fills the holes of a binary mask, in place.
+ *
+ * A hole is a background component that does not touch the border of the volume; it is found
+ * by reconstructing the background from its border voxels.
+ *
+ * @param mask The mask; every non-zero voxel is foreground. Filled voxels are set to 255.
+ * @param connectivity The connectivity of the background: 6 (the complement of a 26-connected
+ * foreground), 18 or 26.
+ * @param num_threads The number of worker threads (0 uses one per hardware core).
+ */
+void fill_holes(Mask3D& mask, int connectivity = 6, unsigned num_threads = 0);
@@ -0,0 +1,57 @@
+#pragma once
+
+#include <array>
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+#include "volume.hpp"
+
+/**
+ * @brief The raw moments of one labeled region, accumulated voxel run by voxel run.
+ *
+ * Coordinates are (i, j, k) in voxels. The moments are exact integer sums, so merging
+ * partial moments gives the same result in any order.
+ */
+struct RegionMoments {
+    uint32_t label = 0;                      ///< The region label.
+    uint64_t volume = 0;                     ///< Number of voxels.
+    std::array<uint64_t, 3> sum{};           ///< Sums of i, j and k.
+    std::array<uint64_t, 6> sum2{};          ///< Sums of ii, jj, kk, ij, ik and jk.
+    std::array<int, 3> min{{-1, -1, -1}};    ///< Smallest (i, j, k) of the bounding box (-1 while empty).
+    std::array<int, 3> max{{-1, -1, -1}};    ///< Largest (i, j, k) of the bounding box, inclusive.
+    uint64_t boundary_faces = 0;             ///< Voxel faces shared with another label or the volume border (if counted).
+
+    /// @brief Adds the `n` voxels (i, j, k0) .. (i, j, k0 + n - 1).
+    void add_run(int i, int j, int k0, int n);
+
+    /// @brief Adds the moments of another part of the same region.
+    void merge(const RegionMoments& other);
+
+    /// @brief Returns the mean (i, j, k) of the region (undefined while empty).
+    std::array<double, 3> centroid() const;
+
+    /**
+     * @brief Returns the central second moments divided by the volume (the covariance of
+     * the voxel coordinates): ii, jj, kk, ij, ik and jk.
+     */
+    std::array<double, 6> covariance() const;
+};
+
+/**
+ * @brief Computes the moments of every label of a label volume in one pass.
+ *
+ * Each worker scans a slab of slices into its own dense table indexed by label, adding
+ * whole runs of equal labels along k at once; the tables are then merged label by label
+ * in parallel. No per-voxel coordinates are stored.
+ *
+ * @param labels The label volume; voxels <= 0 are background.
+ * @param num_threads The number of worker threads (0 uses one per hardware core).
+ * @param count_faces If true, the same pass also counts the boundary faces of every label
+ * by comparing each run with its four neighbouring rows.
+ * @return The moments of labels 1..max label, at index label - 1 (labels absent from the
+ * volume have a zero volume).
+ */
+template<typename T>
+std::vector<RegionMoments> compute_region_moments(const Volume<T>& labels, unsigned num_threads = 0,
+                                                  bool count_faces = false);
@@ -0,0 +1,39 @@
+#pragma once
+
+#include "volume.hpp"
+
+/**
+ * @brief Computes the ultimate homotopic skeleton of a binary object, in process.
+ *
+ * This replaces the `skeleton <in.pgm> 6 <connex> <inhibit.pgm> <out.pgm>` call to Pink:
+ * simple voxels (voxels whose removal changes neither the object nor the background
+ * topology) are removed in order of increasing city-block distance to the background,
+ * until none is left. Voxels of the inhibit image are never removed, so the min-tree
+ * cores of the grains are kept in the skeleton.
+ *
+ * The voxels of one level are split into the 8 parity subfields of the grid (i, j, k mod 2).
+ * Two voxels of a subfield are never 26-adjacent, so the simple voxels of a subfield are
+ * independent: they are tested in parallel and removed together, and the result does not
+ * depend on the thread count. Voxels outside the volume count as background.
+ *
+ * @param object The binary object; every non-zero voxel is foreground.
+ * @param connectivity The object connectivity, 6 or 26 (the background uses the other one).
+ * @param inhibit Optional volume with the dimensions of `object`; its non-zero voxels are kept.
+ * @param num_threads The number of worker threads (0 uses one per hardware core).
+ * @return The skeleton (255 on skeleton voxels, 0 elsewhere).
+ */
+template<typename T>
+Mask3D skeletonize(const Volume<T>& object, int connectivity = 26, const Volume<T>* inhibit = nullptr,
+                   unsigned num_threads = 0);
+
+/**
+ * @brief Tells whether the centre of a 3x3x3 neighbourhood is a simple voxel.
+ *
+ * Uses the topological numbers of Bertrand and Malandain: the centre is simple when the
+ * object and the background each have exactly one component adjacent to it.
+ *
+ * @param neighborhood Bit n is set when the voxel at offset (n / 9 - 1, n / 3 % 3 - 1, n % 3 - 1) is foreground.
+ * @param connectivity The object connectivity, 6 or 26.
+ * @return True if removing the centre preserves the topology.
+ */
+bool is_simple_voxel(uint32_t neighborhood, int connectivity);
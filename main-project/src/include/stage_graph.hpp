@@ -0,0 +1,60 @@
+#pragma once
+
+#include <cstddef>
+#include <functional>
+#include <string>
+#include <vector>
+
+/**
+ * @brief A dependency graph of in-process pipeline stages.
+ *
+ * Each stage is a callable that reads the outputs of its dependencies by reference (typically
+ * volumes owned by the caller) and writes its own, so no intermediate goes through the disk.
+ * run() starts a stage as soon as all its dependencies have finished, so independent
+ * branches of the pipeline run concurrently.
+ */
+class StageGraph {
+public:
+    using StageId = size_t;
+
+    /**
+     * @brief Adds a stage to the graph.
+     * @param name The name printed in the progress log.
+     * @param dependencies The stages that must finish before this one starts (added earlier).
+     * @param body The work of the stage.
+     * @return The identifier of the stage, to be used as a dependency of later stages.
+     * @throws std::invalid_argument If a dependency is not an earlier stage.
+     */
+    StageId add(std::string name, std::vector<StageId> dependencies, std::function<void()> body);
+
+    /**
+     * @brief Runs every stage once, in dependency order.
+     *
+     * If a stage throws, no further stage is started; the first exception is rethrown once
+     * the running stages have finished.
+     *
+     * @param num_threads The number of stages that may run at once (0 uses width()).
+     */
+    void run(unsigned num_threads = 0);
+
+    /// @brief Returns the number of stages.
+    size_t size() const { return stages_.size(); }
+
+    /**
+     * @brief Returns the width of the graph: the largest number of stages on one level, where a
+     * stage's level is the length of its longest chain of dependencies.
+     *
+     * run() starts this many workers by default. Stages that are parallel themselves should
+     * share the thread budget, e.g. give each stage budget / width() threads, so that concurrent
+     * stages do not oversubscribe the cores.
+     */
+    size_t width() const;
+
+private:
+    struct Stage {
+        std::string name;
+        std::vector<StageId> dependencies;
+        std::function<void()> body;
+    };
+    std::vector<Stage> stages_;
+};
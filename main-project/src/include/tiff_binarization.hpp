@@ -2,6 +2,8 @@
 
 #include <string>
 
+#include "common.hpp"
+
 /**
  * @brief Binarizes a 3D TIFF image based on a specified threshold.
  *
@@ -14,4 +16,13 @@
  * @param threshold The integer threshold value to apply.
  * @param outputFile The path to save the resulting binary TIFF file.
  */
-void run_tiff_binarization(const std::string& inputFile, int threshold, const std::string& outputFile);
\ No newline at end of file
+void run_tiff_binarization(const std::string& inputFile, int threshold, const std::string& outputFile);
+
+/**
+ * @brief Binarizes an image in memory, with the rule of run_tiff_binarization().
+ * @param image The input image.
+ * @param threshold Voxels greater than or equal to the threshold become 255, the others 0.
+ * @param num_threads The number of worker threads (0 uses one per hardware core).
+ * @return The binary mask.
+ */
+Mask3D binarize(const Image3D& image, int threshold, unsigned num_threads = 0);
@@ -2,6 +2,8 @@
 
 #include <string>
 
+#include "common.hpp"
+
 /**
  * @brief Performs a binary sum (logical OR operation) on two 3D TIFF images.
  *
@@ -14,4 +16,15 @@
  * @param inputFile2 The path to the second input TIFF image.
  * @param outputFile The path for the output TIFF file containing the result.
  */
-void run_tiff_binary_sum(const std::string& inputFile1, const std::string& inputFile2, const std::string& outputFile);
\ No newline at end of file
+void run_tiff_binary_sum(const std::string& inputFile1, const std::string& inputFile2, const std::string& outputFile);
+
+/**
+ * @brief Computes the binary sum of two images in memory, with the rule of run_tiff_binary_sum().
+ * @param first The first image.
+ * @param second The second image, with the same dimensions.
+ * @param num_threads The number of worker threads (0 uses one per hardware core).
+ * @return The binary mask (255 where either image is >= 255, 0 elsewhere).
+ * @throws std::invalid_argument If the dimensions do not match.
+ */
+template<typename T>
+Mask3D binary_sum(const Volume<T>& first, const Volume<T>& second, unsigned num_threads = 0);
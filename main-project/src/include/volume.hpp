@@ -0,0 +1,185 @@
+#pragma once
+
+#include <algorithm>
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <vector>
+
+/**
+ * @brief A flat voxel buffer that either owns its storage or borrows someone else's.
+ *
+ * The buffer behaves like the `std::vector` it replaces (size(), empty(), operator[],
+ * iteration, assign()), and copying it always produces an owning deep copy, so value
+ * semantics are preserved. Zero-copy sharing is explicit: borrow() wraps foreign memory
+ * without taking ownership, and share() keeps the foreign owner alive for as long as
+ * the buffer (or any moved-to buffer) exists.
+ */
+template<typename T>
+class VoxelBuffer {
+public:
+    using value_type = T;
+
+    VoxelBuffer() = default;
+
+    /**
+     * @brief Takes ownership of a vector of voxels.
+     * @param values The voxels, in the Volume's memory order.
+     */
+    VoxelBuffer(std::vector<T> values) { adopt_vector(std::move(values)); }
+
+    /**
+     * @brief Allocates `count` voxels initialized to `value`.
+     */
+    explicit VoxelBuffer(size_t count, const T& value = T()) { adopt_vector(std::vector<T>(count, value)); }
+
+    /**
+     * @brief Allocates `count` voxels without initializing them.
+     *
+     * Meant for outputs that a parallel kernel writes entirely: each page is then first
+     * touched by the thread that fills it, which keeps memory local on NUMA machines.
+     */
+    static VoxelBuffer uninitialized(size_t count) {
+        std::shared_ptr<T[]> storage(new T[count]);
+        T* data = storage.get();
+        return share(data, count, std::move(storage));
+    }
+
+    /**
+     * @brief Wraps memory owned elsewhere. The memory must outlive the buffer.
+     */
+    static VoxelBuffer borrow(T* data, size_t count) {
+        VoxelBuffer buffer;
+        buffer.ptr_ = data;
+        buffer.size_ = count;
+        return buffer;
+    }
+
+    /**
+     * @brief Wraps memory owned by `owner`, keeping the owner alive with the buffer.
+     */
+    static VoxelBuffer share(T* data, size_t count, std::shared_ptr<void> owner) {
+        VoxelBuffer buffer = borrow(data, count);
+        buffer.owner_ = std::move(owner);
+        return buffer;
+    }
+
+    VoxelBuffer(const VoxelBuffer& other) { adopt_vector(std::vector<T>(other.begin(), other.end())); }
+    VoxelBuffer& operator=(const VoxelBuffer& other) {
+        if (this != &other) adopt_vector(std::vector<T>(other.begin(), other.end()));
+        return *this;
+    }
+    VoxelBuffer(VoxelBuffer&& other) noexcept { swap(other); }
+    VoxelBuffer& operator=(VoxelBuffer&& other) noexcept {
+        VoxelBuffer(std::move(other)).swap(*this);
+        return *this;
+    }
+
+    size_t size() const { return size_; }
+    bool empty() const { return size_ == 0; }
+    T* data() { return ptr_; }
+    const T* data() const { return ptr_; }
+    T& operator[](size_t i) { return ptr_[i]; }
+    const T& operator[](size_t i) const { return ptr_[i]; }
+    T* begin() { return ptr_; }
+    T* end() { return ptr_ + size_; }
+    const T* begin() const { return ptr_; }
+    const T* end() const { return ptr_ + size_; }
+
+    /// @brief Replaces the content with an owning copy of [first, last).
+    template<typename It>
+    void assign(It first, It last) { adopt_vector(std::vector<T>(first, last)); }
+
+    /// @brief Replaces the content with `count` owned copies of `value`.
+    void assign(size_t count, const T& value) { adopt_vector(std::vector<T>(count, value)); }
+
+    /// @brief Returns true if the voxels live in memory this buffer does not manage.
+    bool is_borrowed() const { return ptr_ != nullptr && !owner_; }
+
+    void swap(VoxelBuffer& other) noexcept {
+        std::swap(ptr_, other.ptr_);
+        std::swap(size_, other.size_);
+        std::swap(owner_, other.owner_);
+    }
+
+private:
+    void adopt_vector(std::vector<T> values) {
+        auto storage = std::make_shared<std::vector<T>>(std::move(values));
+        ptr_ = storage->data();
+        size_ = storage->size();
+        owner_ = std::move(storage);
+    }
+
+    T* ptr_ = nullptr;
+    size_t size_ = 0;
+    std::shared_ptr<void> owner_; ///< Keeps owned or shared storage alive; empty when borrowed.
+};
+
+/**
+ * @brief A typed container for 3D image data.
+ *
+ * Voxels are stored in a flattened buffer with `k` varying fastest
+ * (index = k + z_dim * (j + y_dim * i)), which is the row-major order of an
+ * xtensor of shape (x_dim, y_dim, z_dim). Masks and skeletons can therefore use
+ * 8-bit voxels and labels 16 or 32 bits, and the buffer can be shared with
+ * xtensor and Higra without copies (see volume_xtensor.hpp).
+ *
+ * @tparam T The voxel type (e.g. uint8_t, uint16_t, uint32_t, int).
+ */
+template<typename T>
+struct Volume {
+    VoxelBuffer<T> data;
+    long x_dim = 0, y_dim = 0, z_dim = 0;
+
+    /**
+     * @brief Provides direct write access to a voxel at coordinates (i, j, k).
+     * @param i The x-coordinate (row).
+     * @param j The y-coordinate (column).
+     * @param k The z-coordinate (slice).
+     * @return A reference to the voxel value.
+     */
+    T& at(long i, long j, long k) { return data[k + z_dim * (j + y_dim * i)]; }
+
+    /**
+     * @brief Provides direct read-only access to a voxel at coordinates (i, j, k).
+     * @param i The x-coordinate (row).
+     * @param j The y-coordinate (column).
+     * @param k The z-coordinate (slice).
+     * @return A const reference to the voxel value.
+     */
+    const T& at(long i, long j, long k) const { return data[k + z_dim * (j + y_dim * i)]; }
+
+    /// @brief Returns the number of voxels.
+    size_t size() const { return static_cast<size_t>(x_dim) * y_dim * z_dim; }
+};
+
+/**
+ * @brief Allocates a volume of the given dimensions filled with `value`.
+ */
+template<typename T>
+Volume<T> make_volume(long x_dim, long y_dim, long z_dim, const T& value = T()) {
+    return {VoxelBuffer<T>(static_cast<size_t>(x_dim) * y_dim * z_dim, value), x_dim, y_dim, z_dim};
+}
+
+/**
+ * @brief Allocates a volume of the given dimensions without initializing its voxels.
+ * @see VoxelBuffer::uninitialized
+ */
+template<typename T>
+Volume<T> allocate_volume(long x_dim, long y_dim, long z_dim) {
+    return {VoxelBuffer<T>::uninitialized(static_cast<size_t>(x_dim) * y_dim * z_dim), x_dim, y_dim, z_dim};
+}
+
+/**
+ * @brief Converts a volume to another voxel type (always copies).
+ */
+template<typename To, typename From>
+Volume<To> convert_volume(const Volume<From>& volume) {
+    std::vector<To> values(volume.data.size());
+    std::transform(volume.data.begin(), volume.data.end(), values.begin(),
+                   [](const From& v) { return static_cast<To>(v); });
+    return {std::move(values), volume.x_dim, volume.y_dim, volume.z_dim};
+}
+
+using Mask3D = Volume<uint8_t>;    ///< Binary masks and skeletons (0 / non-zero).
+using Labels3D = Volume<uint32_t>; ///< Grain labels.
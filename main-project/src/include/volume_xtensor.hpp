@@ -0,0 +1,74 @@
+#pragma once
+
+#include <array>
+#include <memory>
+#include <type_traits>
+#include <utility>
+
+#include "volume.hpp"
+#include "xtensor/xtensor.hpp"
+#include "xtensor/xadapt.hpp"
+
+/**
+ * @brief Returns a zero-copy xtensor view of shape (x_dim, y_dim, z_dim) over a volume.
+ *
+ * The view can be passed anywhere an xtensor expression is accepted, including
+ * the Higra algorithms (e.g. through hg::xtensor_to_array_view).
+ * @note The view is only valid while the volume's buffer is alive.
+ */
+template<typename T>
+auto as_xtensor(Volume<T>& volume) {
+    std::array<size_t, 3> shape = {size_t(volume.x_dim), size_t(volume.y_dim), size_t(volume.z_dim)};
+    return xt::adapt(volume.data.data(), volume.data.size(), xt::no_ownership(), shape);
+}
+
+/**
+ * @brief Read-only version of as_xtensor.
+ */
+template<typename T>
+auto as_xtensor(const Volume<T>& volume) {
+    std::array<size_t, 3> shape = {size_t(volume.x_dim), size_t(volume.y_dim), size_t(volume.z_dim)};
+    return xt::adapt(volume.data.data(), volume.data.size(), xt::no_ownership(), shape);
+}
+
+/**
+ * @brief Wraps a 3D xtensor container (xtensor, xarray, Higra array) as a volume without copying.
+ * @note The container must outlive the returned volume. Copies of the volume are deep copies.
+ */
+template<typename Container>
+Volume<typename Container::value_type> borrow_volume(Container& tensor) {
+    using T = typename Container::value_type;
+    auto shape = tensor.shape();
+    return {VoxelBuffer<T>::borrow(tensor.data(), tensor.size()),
+            long(shape[0]), long(shape[1]), long(shape[2])};
+}
+
+/**
+ * @brief Read-only version of borrow_volume, for containers received by const reference.
+ * @note The returned volume aliases the container and must not be modified.
+ */
+template<typename Container>
+const Volume<typename Container::value_type> borrow_volume(const Container& tensor) {
+    return borrow_volume(const_cast<Container&>(tensor));
+}
+
+/// Temporaries would die before the volume that borrows them.
+template<typename Container>
+void borrow_volume(const Container&& tensor) = delete;
+
+/**
+ * @brief Moves a 3D xtensor container (xtensor, xarray, Higra array) into a volume without copying.
+ *
+ * The container is kept alive by the volume, so e.g. the output of read_tiff_image_xt or
+ * of a Higra reconstruction can be handed to the contact detectors as-is.
+ */
+template<typename Container, typename = std::enable_if_t<!std::is_lvalue_reference<Container>::value>>
+Volume<typename Container::value_type> adopt_volume(Container&& tensor) {
+    using T = typename Container::value_type;
+    auto owner = std::make_shared<Container>(std::move(tensor));
+    auto shape = owner->shape();
+    T* data = owner->data();
+    size_t size = owner->size();
+    return {VoxelBuffer<T>::share(data, size, std::move(owner)),
+            long(shape[0]), long(shape[1]), long(shape[2])};
+}
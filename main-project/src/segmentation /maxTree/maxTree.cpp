@@ -24,6 +24,8 @@
  
  // Project utils
  #include "ImageProcessingUtils.h"
+ #include "morphology.hpp"
+ #include "volume_xtensor.hpp"
  
  int main(int argc, char* argv[]) {
      if (argc != 4) {
@@ -36,19 +38,19 @@
      int adjacency = std::stoi(argv[3]);
  
      // --- 1. Load Images ---
-     auto image_16bit = read_tiff_image_xt<uint16_t>(image_filepath);
-     auto cores_16bit = read_tiff_image_xt<uint16_t>(seed_filepath);
-     
-     // Convert to 8-bit, as in the Python script
-     auto image = xt::cast<uint8_t>(image_16bit / 256);
-     auto cores = xt::cast<uint8_t>(cores_16bit);
+     // Convert to 8-bit while decoding, as in the Python script (image / 256, markers cast as-is)
+     xt::xtensor<uint8_t, 3> image = read_tiff_image_xt<uint8_t>(image_filepath, VoxelTransform::shift(8));
+     xt::xtensor<uint8_t, 3> cores = read_tiff_image_xt<uint8_t>(seed_filepath);
      std::cout << "Loaded image has shape: " << image.shape()[0] << "x" << image.shape()[1] << "x" << image.shape()[2] << std::endl;
  
      // --- 2. Create Higra Graph ---
      auto graph = hg::make_graph_from_implicit_graph(hg::get_3d_implicit_graph(image.shape(), adjacency == 26 ? hg::adjacency::cube : hg::adjacency::face));
      
      // --- 3. Merge Image and Markers ---
-     auto dilated_cores = dilate_with_ball(cores, 2.2);
+     // The cores are not needed undilated, so they are dilated in place.
+     Mask3D core_mask = borrow_volume(cores);
+     dilate_ball(core_mask, 2.2);
+     auto& dilated_cores = cores;
  
      int num_cores = 0;
      label_components(dilated_cores > 0, num_cores); // Call just to get the count
@@ -27,6 +27,7 @@
  
  // Project utils
  #include "ImageProcessingUtils.h"
+ #include "MappedVolume.h"
  #include "dstyle.h"
  
  int main(int argc, char* argv[]) {
@@ -50,8 +51,11 @@
      animation.show("Processing " + filename);
  
      // --- 1. Load Image ---
-     auto image_16bit = read_tiff_image_xt<uint16_t>(filepath);
-     auto image = xt::cast<uint8_t>(image_16bit / 256);
+     // A 16-bit scan is reduced to 8 bits (v / 256) while decoding, so only the 8-bit image is allocated.
+     // An 8-bit scan needs no conversion and is mapped instead of copied when it is stored uncompressed.
+     const bool is_8bit = load_tiff_directory_index(filepath).bits_per_sample == 8;
+     auto volume = MappedVolume<uint8_t>::open_tiff(filepath, is_8bit ? VoxelTransform::identity() : VoxelTransform::shift(8));
+     auto image = volume.view();
  
      // --- 2. Create Higra Graph ---
      auto graph = hg::make_graph_from_implicit_graph(hg::get_3d_implicit_graph(image.shape(), adjacency == 26 ? hg::adjacency::cube : hg::adjacency::face));
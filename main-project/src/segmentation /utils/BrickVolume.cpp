@@ -0,0 +1,332 @@
+/**
+ * @file BrickVolume.cpp
+ * @brief Implements the chunked, compressed brick volume reader and writer.
+ */
+
+ #include "BrickVolume.h"
+ #include "ParallelUtils.h"
+ #include <fcntl.h>
+ #include <unistd.h>
+ #include <cstring>
+ #include <fstream>
+ #include <stdexcept>
+
+ namespace {
+
+ constexpr char kBrickIndexMagic[4] = {'G', 'B', 'I', 'X'};
+ constexpr uint32_t kBrickIndexVersion = 1;
+
+ std::string brick_data_path(const std::string& base_path) { return base_path + ".bricks"; }
+ std::string brick_index_path(const std::string& base_path) { return base_path + ".bidx"; }
+
+ /**
+  * @brief Copies brick (origin, extent) out of a row-major volume into a contiguous buffer.
+  */
+ template<typename T>
+ void gather_brick(const T* volume, const std::array<size_t, 3>& volume_shape,
+                   const std::array<size_t, 3>& origin, const std::array<size_t, 3>& extent, T* brick) {
+     for (size_t z = 0; z < extent[0]; ++z) {
+         for (size_t y = 0; y < extent[1]; ++y) {
+             const T* row = volume + ((origin[0] + z) * volume_shape[1] + origin[1] + y) * volume_shape[2] + origin[2];
+             std::copy_n(row, extent[2], brick + (z * extent[1] + y) * extent[2]);
+         }
+     }
+ }
+
+ /**
+  * @brief Reads exactly `size` bytes at `offset`, retrying on short reads.
+  */
+ void pread_fully(int fd, void* dest, size_t size, uint64_t offset, const std::string& path) {
+     unsigned char* out = static_cast<unsigned char*>(dest);
+     while (size > 0) {
+         ssize_t n = pread(fd, out, size, static_cast<off_t>(offset));
+         if (n <= 0) {
+             throw std::runtime_error("Error: Failed to read brick data from " + path);
+         }
+         out += n;
+         offset += static_cast<uint64_t>(n);
+         size -= static_cast<size_t>(n);
+     }
+ }
+
+ } // namespace
+
+
+ // --- BrickVolumeWriter ---
+
+ template<typename T>
+ BrickVolumeWriter<T>::BrickVolumeWriter(const std::string& base_path, const std::array<size_t, 3>& shape,
+                                         const std::array<size_t, 3>& brick_shape, Compression compression, int level)
+     : base_path_(base_path), level_(level) {
+     if (!codec_is_available(compression)) {
+         throw std::invalid_argument("Error: Brick volumes only support in-process codecs (none, deflate, zstd).");
+     }
+     if (brick_shape[0] == 0 || brick_shape[1] == 0 || brick_shape[2] == 0) {
+         throw std::invalid_argument("Error: Brick dimensions must be positive.");
+     }
+
+     info_.shape = shape;
+     info_.brick_shape = brick_shape;
+     info_.compression = compression;
+     info_.bytes_per_voxel = sizeof(T);
+     offsets_.assign(info_.brick_count(), 0);
+     sizes_.assign(info_.brick_count(), 0);
+
+     data_ = std::fopen(brick_data_path(base_path_).c_str(), "wb");
+     if (!data_) {
+         throw std::runtime_error("Error: Could not open file for writing: " + brick_data_path(base_path_));
+     }
+ }
+
+ template<typename T>
+ BrickVolumeWriter<T>::~BrickVolumeWriter() {
+     try {
+         close();
+     } catch (const std::exception& e) {
+         std::fprintf(stderr, "Error: %s\n", e.what());
+     }
+ }
+
+ template<typename T>
+ void BrickVolumeWriter<T>::store_block(size_t index, const std::vector<unsigned char>& block) {
+     if (!data_) {
+         throw std::runtime_error("Error: Brick volume is already closed: " + base_path_);
+     }
+     if (std::fwrite(block.data(), 1, block.size(), data_) != block.size()) {
+         throw std::runtime_error("Error: Failed to write brick data to " + brick_data_path(base_path_));
+     }
+     // Rewriting a brick simply points the index at the newest copy.
+     offsets_[index] = data_size_;
+     sizes_[index] = block.size();
+     data_size_ += block.size();
+ }
+
+ template<typename T>
+ void BrickVolumeWriter<T>::write_brick(size_t bz, size_t by, size_t bx, const xt::xtensor<T, 3>& brick) {
+     auto grid = info_.grid();
+     if (bz >= grid[0] || by >= grid[1] || bx >= grid[2]) {
+         throw std::out_of_range("Error: Brick coordinates are outside the volume.");
+     }
+     auto extent = info_.brick_extent(bz, by, bx);
+     if (brick.shape()[0] != extent[0] || brick.shape()[1] != extent[1] || brick.shape()[2] != extent[2]) {
+         throw std::invalid_argument("Error: Brick shape does not match the volume layout.");
+     }
+     store_block(info_.brick_index(bz, by, bx),
+                 compress_buffer(brick.data(), brick.size() * sizeof(T), info_.compression, level_));
+ }
+
+ template<typename T>
+ void BrickVolumeWriter<T>::write_slab(size_t z_begin, const xt::xtensor<T, 3>& slab, unsigned num_threads) {
+     const auto& bs = info_.brick_shape;
+     const size_t z_end = z_begin + slab.shape()[0];
+     if (z_begin % bs[0] != 0 || z_end > info_.shape[0] || (z_end % bs[0] != 0 && z_end != info_.shape[0]) ||
+         slab.shape()[1] != info_.shape[1] || slab.shape()[2] != info_.shape[2]) {
+         throw std::invalid_argument("Error: Slab is not aligned with the brick layers of the volume.");
+     }
+
+     auto grid = info_.grid();
+     const size_t first_layer = z_begin / bs[0];
+     const size_t layers = (z_end - z_begin + bs[0] - 1) / bs[0];
+     const size_t bricks_per_layer = grid[1] * grid[2];
+     const std::array<size_t, 3> slab_shape = {slab.shape()[0], slab.shape()[1], slab.shape()[2]};
+
+     std::vector<std::vector<unsigned char>> blocks(layers * bricks_per_layer);
+     parallel_for(0, blocks.size(), num_threads, [&](size_t i) {
+         size_t bz = first_layer + i / bricks_per_layer;
+         size_t by = (i % bricks_per_layer) / grid[2];
+         size_t bx = i % grid[2];
+         auto extent = info_.brick_extent(bz, by, bx);
+         std::vector<T> brick(extent[0] * extent[1] * extent[2]);
+         gather_brick(slab.data(), slab_shape, {bz * bs[0] - z_begin, by * bs[1], bx * bs[2]}, extent, brick.data());
+         blocks[i] = compress_buffer(brick.data(), brick.size() * sizeof(T), info_.compression, level_);
+     });
+
+     for (size_t i = 0; i < blocks.size(); ++i) {
+         store_block(first_layer * bricks_per_layer + i, blocks[i]);
+     }
+ }
+
+ template<typename T>
+ void BrickVolumeWriter<T>::close() {
+     if (!data_) return;
+     std::fclose(data_);
+     data_ = nullptr;
+
+     std::ofstream out(brick_index_path(base_path_), std::ios::out | std::ios::binary);
+     if (!out) {
+         throw std::runtime_error("Error: Could not write brick index: " + brick_index_path(base_path_));
+     }
+
+     uint64_t header[6] = {info_.shape[0], info_.shape[1], info_.shape[2],
+                           info_.brick_shape[0], info_.brick_shape[1], info_.brick_shape[2]};
+     uint32_t compression = static_cast<uint32_t>(info_.compression);
+     uint64_t count = offsets_.size();
+
+     out.write(kBrickIndexMagic, sizeof(kBrickIndexMagic));
+     out.write(reinterpret_cast<const char*>(&kBrickIndexVersion), sizeof(kBrickIndexVersion));
+     out.write(reinterpret_cast<const char*>(header), sizeof(header));
+     out.write(reinterpret_cast<const char*>(&compression), sizeof(compression));
+     out.write(reinterpret_cast<const char*>(&info_.bytes_per_voxel), sizeof(info_.bytes_per_voxel));
+     out.write(reinterpret_cast<const char*>(&count), sizeof(count));
+     out.write(reinterpret_cast<const char*>(offsets_.data()), count * sizeof(uint64_t));
+     out.write(reinterpret_cast<const char*>(sizes_.data()), count * sizeof(uint64_t));
+     if (!out) {
+         throw std::runtime_error("Error: Failed to write brick index: " + brick_index_path(base_path_));
+     }
+ }
+
+
+ // --- BrickVolumeReader ---
+
+ template<typename T>
+ BrickVolumeReader<T>::BrickVolumeReader(const std::string& base_path) : base_path_(base_path) {
+     std::ifstream in(brick_index_path(base_path_), std::ios::in | std::ios::binary);
+     if (!in) {
+         throw std::runtime_error("Error: Could not open brick index: " + brick_index_path(base_path_));
+     }
+
+     char magic[4];
+     uint32_t version = 0, compression = 0;
+     uint64_t header[6];
+     uint64_t count = 0;
+     in.read(magic, sizeof(magic));
+     in.read(reinterpret_cast<char*>(&version), sizeof(version));
+     in.read(reinterpret_cast<char*>(header), sizeof(header));
+     in.read(reinterpret_cast<char*>(&compression), sizeof(compression));
+     in.read(reinterpret_cast<char*>(&info_.bytes_per_voxel), sizeof(info_.bytes_per_voxel));
+     in.read(reinterpret_cast<char*>(&count), sizeof(count));
+     if (!in || !std::equal(magic, magic + 4, kBrickIndexMagic) || version != kBrickIndexVersion) {
+         throw std::runtime_error("Error: Invalid brick index: " + brick_index_path(base_path_));
+     }
+
+     info_.shape = {header[0], header[1], header[2]};
+     info_.brick_shape = {header[3], header[4], header[5]};
+     info_.compression = static_cast<Compression>(compression);
+     if (info_.bytes_per_voxel != sizeof(T) || count != info_.brick_count()) {
+         throw std::runtime_error("Error: Brick volume voxel type or layout does not match: " + base_path_);
+     }
+
+     offsets_.resize(count);
+     sizes_.resize(count);
+     in.read(reinterpret_cast<char*>(offsets_.data()), count * sizeof(uint64_t));
+     in.read(reinterpret_cast<char*>(sizes_.data()), count * sizeof(uint64_t));
+     if (!in) {
+         throw std::runtime_error("Error: Truncated brick index: " + brick_index_path(base_path_));
+     }
+
+     fd_ = ::open(brick_data_path(base_path_).c_str(), O_RDONLY);
+     if (fd_ < 0) {
+         throw std::runtime_error("Error: Could not open brick data: " + brick_data_path(base_path_));
+     }
+ }
+
+ template<typename T>
+ BrickVolumeReader<T>::~BrickVolumeReader() {
+     if (fd_ >= 0) ::close(fd_);
+ }
+
+ template<typename T>
+ void BrickVolumeReader<T>::read_brick_into(size_t bz, size_t by, size_t bx, T* dest) const {
+     auto extent = info_.brick_extent(bz, by, bx);
+     const size_t bytes = extent[0] * extent[1] * extent[2] * sizeof(T);
+     const size_t index = info_.brick_index(bz, by, bx);
+
+     if (sizes_[index] == 0) {
+         // Bricks that were never written are empty (background).
+         std::memset(dest, 0, bytes);
+         return;
+     }
+     std::vector<unsigned char> block(sizes_[index]);
+     pread_fully(fd_, block.data(), block.size(), offsets_[index], brick_data_path(base_path_));
+     decompress_buffer(block.data(), block.size(), dest, bytes, info_.compression);
+ }
+
+ template<typename T>
+ xt::xtensor<T, 3> BrickVolumeReader<T>::read_brick(size_t bz, size_t by, size_t bx) const {
+     auto grid = info_.grid();
+     if (bz >= grid[0] || by >= grid[1] || bx >= grid[2]) {
+         throw std::out_of_range("Error: Brick coordinates are outside the volume.");
+     }
+     auto extent = info_.brick_extent(bz, by, bx);
+     xt::xtensor<T, 3> brick = xt::empty<T>({extent[0], extent[1], extent[2]});
+     read_brick_into(bz, by, bx, brick.data());
+     return brick;
+ }
+
+ template<typename T>
+ xt::xtensor<T, 3> BrickVolumeReader<T>::read_region(const std::array<size_t, 3>& begin, const std::array<size_t, 3>& end,
+                                                     unsigned num_threads) const {
+     for (int a = 0; a < 3; ++a) {
+         if (begin[a] > end[a] || end[a] > info_.shape[a]) {
+             throw std::out_of_range("Error: Requested region is outside the brick volume.");
+         }
+     }
+
+     const auto& bs = info_.brick_shape;
+     const std::array<size_t, 3> out_shape = {end[0] - begin[0], end[1] - begin[1], end[2] - begin[2]};
+     xt::xtensor<T, 3> region = xt::empty<T>({out_shape[0], out_shape[1], out_shape[2]});
+     if (out_shape[0] == 0 || out_shape[1] == 0 || out_shape[2] == 0) return region;
+
+     // Bricks intersecting the region: [first, last] along each axis.
+     std::array<size_t, 3> first, count;
+     for (int a = 0; a < 3; ++a) {
+         first[a] = begin[a] / bs[a];
+         count[a] = (end[a] - 1) / bs[a] - first[a] + 1;
+     }
+
+     parallel_for(0, count[0] * count[1] * count[2], num_threads, [&](size_t i) {
+         const size_t bz = first[0] + i / (count[1] * count[2]);
+         const size_t by = first[1] + (i / count[2]) % count[1];
+         const size_t bx = first[2] + i % count[2];
+         auto extent = info_.brick_extent(bz, by, bx);
+         std::vector<T> brick(extent[0] * extent[1] * extent[2]);
+         read_brick_into(bz, by, bx, brick.data());
+
+         // Copy the part of the brick that falls inside the region; bricks never overlap,
+         // so workers write disjoint parts of the output.
+         const std::array<size_t, 3> origin = {bz * bs[0], by * bs[1], bx * bs[2]};
+         std::array<size_t, 3> lo, hi;
+         for (int a = 0; a < 3; ++a) {
+             lo[a] = std::max(begin[a], origin[a]);
+             hi[a] = std::min(end[a], origin[a] + extent[a]);
+         }
+         for (size_t z = lo[0]; z < hi[0]; ++z) {
+             for (size_t y = lo[1]; y < hi[1]; ++y) {
+                 const T* src = brick.data() + ((z - origin[0]) * extent[1] + (y - origin[1])) * extent[2] + (lo[2] - origin[2]);
+                 T* dst = region.data() + ((z - begin[0]) * out_shape[1] + (y - begin[1])) * out_shape[2] + (lo[2] - begin[2]);
+                 std::copy_n(src, hi[2] - lo[2], dst);
+             }
+         }
+     });
+
+     return region;
+ }
+
+ template<typename T>
+ xt::xtensor<T, 3> BrickVolumeReader<T>::read_volume(unsigned num_threads) const {
+     return read_region({0, 0, 0}, info_.shape, num_threads);
+ }
+
+
+ // --- Conversion ---
+
+ template<typename T>
+ void write_brick_volume(const xt::xtensor<T, 3>& image, const std::string& base_path,
+                         const std::array<size_t, 3>& brick_shape, Compression compression, unsigned num_threads) {
+     const std::array<size_t, 3> shape = {image.shape()[0], image.shape()[1], image.shape()[2]};
+     BrickVolumeWriter<T> writer(base_path, shape, brick_shape, compression);
+     writer.write_slab(0, image, num_threads);
+     writer.close();
+ }
+
+
+ // Explicit template instantiations (after the member definitions, so every member is emitted)
+ template class BrickVolumeWriter<uint8_t>;
+ template class BrickVolumeWriter<uint16_t>;
+ template class BrickVolumeWriter<uint32_t>;
+ template class BrickVolumeReader<uint8_t>;
+ template class BrickVolumeReader<uint16_t>;
+ template class BrickVolumeReader<uint32_t>;
+ template void write_brick_volume<uint8_t>(const xt::xtensor<uint8_t, 3>&, const std::string&, const std::array<size_t, 3>&, Compression, unsigned);
+ template void write_brick_volume<uint16_t>(const xt::xtensor<uint16_t, 3>&, const std::string&, const std::array<size_t, 3>&, Compression, unsigned);
+ template void write_brick_volume<uint32_t>(const xt::xtensor<uint32_t, 3>&, const std::string&, const std::array<size_t, 3>&, Compression, unsigned);
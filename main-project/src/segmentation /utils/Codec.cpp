@@ -0,0 +1,98 @@
+/**
+ * @file Codec.cpp
+ * @brief Implements the block compression codecs on top of zlib and zstd.
+ */
+
+ #include "Codec.h"
+ #include <zlib.h>
+ #include <stdexcept>
+ #include <string>
+ #include <cstring>
+ #ifdef GRAIN_HAVE_ZSTD
+ #include <zstd.h>
+ #endif
+
+ bool codec_is_available(Compression compression) {
+     switch (compression) {
+         case Compression::None:
+         case Compression::Deflate:
+             return true;
+         case Compression::Zstd:
+ #ifdef GRAIN_HAVE_ZSTD
+             return true;
+ #else
+             return false;
+ #endif
+         case Compression::LZW:
+         default:
+             return false;
+     }
+ }
+
+ std::vector<unsigned char> compress_buffer(const void* data, size_t size, Compression compression, int level) {
+     const unsigned char* bytes = static_cast<const unsigned char*>(data);
+
+     switch (compression) {
+         case Compression::None:
+             return std::vector<unsigned char>(bytes, bytes + size);
+
+         case Compression::Deflate: {
+             uLongf compressed_size = compressBound(static_cast<uLong>(size));
+             std::vector<unsigned char> out(compressed_size);
+             int z_level = level < 0 ? Z_DEFAULT_COMPRESSION : level;
+             if (compress2(out.data(), &compressed_size, bytes, static_cast<uLong>(size), z_level) != Z_OK) {
+                 throw std::runtime_error("Error: Deflate compression failed.");
+             }
+             out.resize(compressed_size);
+             return out;
+         }
+
+ #ifdef GRAIN_HAVE_ZSTD
+         case Compression::Zstd: {
+             std::vector<unsigned char> out(ZSTD_compressBound(size));
+             int z_level = level < 0 ? ZSTD_CLEVEL_DEFAULT : level;
+             size_t compressed_size = ZSTD_compress(out.data(), out.size(), bytes, size, z_level);
+             if (ZSTD_isError(compressed_size)) {
+                 throw std::runtime_error(std::string("Error: Zstd compression failed: ") + ZSTD_getErrorName(compressed_size));
+             }
+             out.resize(compressed_size);
+             return out;
+         }
+ #endif
+
+         default:
+             throw std::runtime_error("Error: Compression scheme is not available in-process.");
+     }
+ }
+ 
+ void decompress_buffer(const unsigned char* src, size_t src_size, void* dst, size_t dst_size, Compression compression) {
+     switch (compression) {
+         case Compression::None:
+             if (src_size != dst_size) {
+                 throw std::runtime_error("Error: Stored block has an unexpected size.");
+             }
+             std::memcpy(dst, src, dst_size);
+             return;
+ 
+         case Compression::Deflate: {
+             uLongf out_size = static_cast<uLongf>(dst_size);
+             if (uncompress(static_cast<Bytef*>(dst), &out_size, src, static_cast<uLong>(src_size)) != Z_OK || out_size != dst_size) {
+                 throw std::runtime_error("Error: Deflate decompression failed.");
+             }
+             return;
+         }
+ 
+ #ifdef GRAIN_HAVE_ZSTD
+         case Compression::Zstd: {
+             size_t out_size = ZSTD_decompress(dst, dst_size, src, src_size);
+             if (ZSTD_isError(out_size) || out_size != dst_size) {
+                 throw std::runtime_error("Error: Zstd decompression failed.");
+             }
+             return;
+         }
+ #endif
+ 
+         default:
+             throw std::runtime_error("Error: Compression scheme is not available in-process.");
+     }
+ }
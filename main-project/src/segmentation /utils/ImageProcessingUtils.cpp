@@ -7,89 +7,614 @@
  #include <tiffio.h>
  #include <iostream>
  #include <stdexcept>
+ #include <algorithm>
+ #include <array>
+ #include <vector>
+ #include <fstream>
+ #include <filesystem>
+ #include <utility>
+ #include <type_traits>
  #include "xtensor/xadapt.hpp"
+ #include "ParallelUtils.h"
+ #include "connected_components.hpp"
+ #include "morphology.hpp"
+ #include "region_moments.hpp"
+ #include "volume_xtensor.hpp"
  
  // Explicit template instantiations
- template xt::xtensor<uint8_t, 3> read_tiff_image_xt<uint8_t>(const std::string&);
- template xt::xtensor<uint16_t, 3> read_tiff_image_xt<uint16_t>(const std::string&);
- template void write_tiff_image_xt<uint32_t>(const xt::xtensor<uint32_t, 3>&, const std::string&);
- template void write_tiff_image_xt<uint8_t>(const xt::xtensor<uint8_t, 3>&, const std::string&);
+ template xt::xtensor<uint8_t, 3> read_tiff_image_xt<uint8_t>(const std::string&, unsigned);
+ template xt::xtensor<uint16_t, 3> read_tiff_image_xt<uint16_t>(const std::string&, unsigned);
+ template xt::xtensor<uint32_t, 3> read_tiff_image_xt<uint32_t>(const std::string&, unsigned);
+ template xt::xtensor<int16_t, 3> read_tiff_image_xt<int16_t>(const std::string&, unsigned);
+ template xt::xtensor<uint8_t, 3> read_tiff_slices_xt<uint8_t>(const std::string&, const TiffDirectoryIndex&, size_t, size_t, unsigned);
+ template xt::xtensor<uint16_t, 3> read_tiff_slices_xt<uint16_t>(const std::string&, const TiffDirectoryIndex&, size_t, size_t, unsigned);
+ template xt::xtensor<uint32_t, 3> read_tiff_slices_xt<uint32_t>(const std::string&, const TiffDirectoryIndex&, size_t, size_t, unsigned);
+ template xt::xtensor<int16_t, 3> read_tiff_slices_xt<int16_t>(const std::string&, const TiffDirectoryIndex&, size_t, size_t, unsigned);
+ template xt::xtensor<uint8_t, 3> read_tiff_image_xt<uint8_t>(const std::string&, const VoxelTransform&, unsigned);
+ template xt::xtensor<uint16_t, 3> read_tiff_image_xt<uint16_t>(const std::string&, const VoxelTransform&, unsigned);
+ template xt::xtensor<uint32_t, 3> read_tiff_image_xt<uint32_t>(const std::string&, const VoxelTransform&, unsigned);
+ template xt::xtensor<float, 3> read_tiff_image_xt<float>(const std::string&, const VoxelTransform&, unsigned);
+ template xt::xtensor<uint8_t, 3> read_tiff_slices_xt<uint8_t>(const std::string&, const TiffDirectoryIndex&, size_t, size_t, const VoxelTransform&, unsigned);
+ template xt::xtensor<uint16_t, 3> read_tiff_slices_xt<uint16_t>(const std::string&, const TiffDirectoryIndex&, size_t, size_t, const VoxelTransform&, unsigned);
+ template xt::xtensor<uint32_t, 3> read_tiff_slices_xt<uint32_t>(const std::string&, const TiffDirectoryIndex&, size_t, size_t, const VoxelTransform&, unsigned);
+ template xt::xtensor<int16_t, 3> read_tiff_slices_xt<int16_t>(const std::string&, const TiffDirectoryIndex&, size_t, size_t, const VoxelTransform&, unsigned);
+ template xt::xtensor<float, 3> read_tiff_slices_xt<float>(const std::string&, const TiffDirectoryIndex&, size_t, size_t, const VoxelTransform&, unsigned);
+ template void write_tiff_image_xt<uint32_t>(const xt::xtensor<uint32_t, 3>&, const std::string&, const TiffWriteOptions&);
+ template void write_tiff_image_xt<uint16_t>(const xt::xtensor<uint16_t, 3>&, const std::string&, const TiffWriteOptions&);
+ template void write_tiff_image_xt<uint8_t>(const xt::xtensor<uint8_t, 3>&, const std::string&, const TiffWriteOptions&);
  
  
+ namespace {
+ 
+ /**
+  * @brief Converts a decoded buffer of unsigned samples of another bit depth into T.
+  * @note The caller makes sure the samples fit in T (see decode_tiff_directory).
+  */
+ template<typename T>
+ void widen_samples(const unsigned char* src, uint16_t bits_per_sample, T* dst, size_t count) {
+     for (size_t i = 0; i < count; ++i) {
+         switch (bits_per_sample) {
+             case 8:  dst[i] = static_cast<T>(src[i]); break;
+             case 16: dst[i] = static_cast<T>(reinterpret_cast<const uint16_t*>(src)[i]); break;
+             case 32: dst[i] = static_cast<T>(reinterpret_cast<const uint32_t*>(src)[i]); break;
+             default: throw std::runtime_error("Error: Unsupported TIFF bit depth: " + std::to_string(bits_per_sample));
+         }
+     }
+ }
+ 
+ /**
+  * @brief Converts decoded unsigned samples into T through a VoxelTransform.
+  *
+  * 8- and 16-bit samples go through lookup tables built once per read, so converting
+  * costs one load per voxel whatever the transform; 32-bit samples are converted directly.
+  */
+ template<typename T>
+ class SampleConverter {
+ public:
+     explicit SampleConverter(const VoxelTransform& transform)
+         : transform_(transform), lut8_(1 << 8), lut16_(1 << 16) {
+         for (size_t v = 0; v < lut8_.size(); ++v) lut8_[v] = transform_.apply<T>(double(v));
+         for (size_t v = 0; v < lut16_.size(); ++v) lut16_[v] = transform_.apply<T>(double(v));
+     }
+ 
+     void operator()(const unsigned char* src, uint16_t bits_per_sample, T* dst, size_t count) const {
+         switch (bits_per_sample) {
+             case 8:
+                 for (size_t i = 0; i < count; ++i) dst[i] = lut8_[src[i]];
+                 break;
+             case 16: {
+                 const uint16_t* samples = reinterpret_cast<const uint16_t*>(src);
+                 for (size_t i = 0; i < count; ++i) dst[i] = lut16_[samples[i]];
+                 break;
+             }
+             case 32: {
+                 const uint32_t* samples = reinterpret_cast<const uint32_t*>(src);
+                 for (size_t i = 0; i < count; ++i) dst[i] = transform_.apply<T>(double(samples[i]));
+                 break;
+             }
+             default: throw std::runtime_error("Error: Unsupported TIFF bit depth: " + std::to_string(bits_per_sample));
+         }
+     }
+ 
+ private:
+     VoxelTransform transform_;
+     std::vector<T> lut8_, lut16_;
+ };
+ 
+ /**
+  * @brief Decodes the current directory of an open TIFF handle into a destination slice.
+  *
+  * Striped images are decoded strip by strip; when the file's bit depth matches T the
+  * strips are decoded directly into the destination without an intermediate copy.
+  * Tiled images are decoded tile by tile and the valid part of each tile is copied.
+  * With a converter, every strip or tile goes through the scratch buffer and is
+  * converted while it is copied into the destination.
+  *
+  * @param tif The TIFF handle, positioned on the directory to decode.
+  * @param dest A pointer to the first voxel of the destination slice (height * width voxels).
+  * @param width The expected slice width.
+  * @param height The expected slice height.
+  * @param scratch A reusable per-thread buffer for tiles and bit-depth conversion.
+  * @param convert The conversion of the stored samples, or nullptr to widen them as-is.
+  */
  template<typename T>
- xt::xtensor<T, 3> read_tiff_image_xt(const std::string& filepath) {
+ void decode_tiff_directory(TIFF* tif, T* dest, uint32_t width, uint32_t height, std::vector<unsigned char>& scratch,
+                            const SampleConverter<T>* convert = nullptr) {
+     uint32_t dir_width = 0, dir_height = 0;
+     uint16_t bits_per_sample = 8, samples_per_pixel = 1;
+     TIFFGetField(tif, TIFFTAG_IMAGEWIDTH, &dir_width);
+     TIFFGetField(tif, TIFFTAG_IMAGELENGTH, &dir_height);
+     TIFFGetFieldDefaulted(tif, TIFFTAG_BITSPERSAMPLE, &bits_per_sample);
+     TIFFGetFieldDefaulted(tif, TIFFTAG_SAMPLESPERPIXEL, &samples_per_pixel);
+ 
+     if (dir_width != width || dir_height != height) {
+         throw std::runtime_error("Error: TIFF slices do not all have the same dimensions.");
+     }
+     if (samples_per_pixel != 1) {
+         throw std::runtime_error("Error: Only single-channel TIFF images are supported.");
+     }
+ 
+     // Signed and floating-point samples are only decoded as-is, into a voxel type of the same kind;
+     // conversions (widening or a VoxelTransform) work on unsigned samples.
+     uint16_t sample_format = SAMPLEFORMAT_UINT;
+     TIFFGetFieldDefaulted(tif, TIFFTAG_SAMPLEFORMAT, &sample_format);
+     const bool same_kind = sample_format == SAMPLEFORMAT_UINT ? std::is_integral<T>::value && std::is_unsigned<T>::value
+                          : sample_format == SAMPLEFORMAT_INT  ? std::is_integral<T>::value && std::is_signed<T>::value
+                          : sample_format == SAMPLEFORMAT_IEEEFP && std::is_floating_point<T>::value;
+     const size_t bytes_per_sample = bits_per_sample / 8;
+     const bool same_depth = (bytes_per_sample == sizeof(T)) && !convert && same_kind;
+     if (sample_format != SAMPLEFORMAT_UINT && !same_depth) {
+         throw std::runtime_error("Error: TIFF sample format " + std::to_string(sample_format) +
+                                  " can only be read into a voxel type of the same kind and bit depth.");
+     }
+     if (!convert && std::is_integral<T>::value && bits_per_sample > sizeof(T) * 8) {
+         throw std::runtime_error("Error: TIFF samples (" + std::to_string(bits_per_sample) +
+                                  "-bit) are wider than the voxel type; pass a VoxelTransform to convert them.");
+     }
+     auto to_voxels = [&](const unsigned char* src, T* dst, size_t count) {
+         if (convert) (*convert)(src, bits_per_sample, dst, count);
+         else widen_samples(src, bits_per_sample, dst, count);
+     };
+ 
+     if (TIFFIsTiled(tif)) {
+         uint32_t tile_width = 0, tile_height = 0;
+         TIFFGetField(tif, TIFFTAG_TILEWIDTH, &tile_width);
+         TIFFGetField(tif, TIFFTAG_TILELENGTH, &tile_height);
+         scratch.resize(TIFFTileSize(tif));
+         std::vector<T> converted(same_depth ? 0 : size_t(tile_width) * tile_height);
+ 
+         for (uint32_t y = 0; y < height; y += tile_height) {
+             for (uint32_t x = 0; x < width; x += tile_width) {
+                 ttile_t tile = TIFFComputeTile(tif, x, y, 0, 0);
+                 if (TIFFReadEncodedTile(tif, tile, scratch.data(), scratch.size()) < 0) {
+                     throw std::runtime_error("Error: Failed to decode TIFF tile.");
+                 }
+                 const T* tile_data = reinterpret_cast<const T*>(scratch.data());
+                 if (!same_depth) {
+                     to_voxels(scratch.data(), converted.data(), converted.size());
+                     tile_data = converted.data();
+                 }
+                 // Tiles on the right and bottom edges are padded; copy only the valid part.
+                 uint32_t rows = std::min(tile_height, height - y);
+                 uint32_t cols = std::min(tile_width, width - x);
+                 for (uint32_t r = 0; r < rows; ++r) {
+                     std::copy_n(tile_data + size_t(r) * tile_width, cols, dest + size_t(y + r) * width + x);
+                 }
+             }
+         }
+         return;
+     }
+ 
+     uint32_t rows_per_strip = height;
+     TIFFGetFieldDefaulted(tif, TIFFTAG_ROWSPERSTRIP, &rows_per_strip);
+     rows_per_strip = std::min(rows_per_strip, height);
+     const uint32_t num_strips = TIFFNumberOfStrips(tif);
+ 
+     for (uint32_t strip = 0; strip < num_strips; ++strip) {
+         uint32_t first_row = strip * rows_per_strip;
+         if (first_row >= height) break;
+         size_t count = size_t(std::min(rows_per_strip, height - first_row)) * width;
+         T* strip_dest = dest + size_t(first_row) * width;
+ 
+         if (same_depth) {
+             // Decode straight into the destination tensor.
+             if (TIFFReadEncodedStrip(tif, strip, strip_dest, count * sizeof(T)) < 0) {
+                 throw std::runtime_error("Error: Failed to decode TIFF strip.");
+             }
+         } else {
+             scratch.resize(count * bytes_per_sample);
+             if (TIFFReadEncodedStrip(tif, strip, scratch.data(), scratch.size()) < 0) {
+                 throw std::runtime_error("Error: Failed to decode TIFF strip.");
+             }
+             to_voxels(scratch.data(), strip_dest, count);
+         }
+     }
+ }
+ 
+ } // namespace
+ 
+ // --- TIFF Directory Index ---
+ 
+ namespace {
+ 
+ constexpr char kIndexMagic[4] = {'G', 'I', 'F', 'D'};
+ constexpr uint32_t kIndexVersion = 2;
+ 
+ /**
+  * @brief Returns the size and modification time used to detect a stale sidecar index.
+  */
+ std::pair<uint64_t, int64_t> tiff_file_signature(const std::string& filepath) {
+     std::error_code ec;
+     uint64_t size = std::filesystem::file_size(filepath, ec);
+     if (ec) return {0, 0};
+     auto mtime = std::filesystem::last_write_time(filepath, ec);
+     if (ec) return {size, 0};
+     return {size, static_cast<int64_t>(mtime.time_since_epoch().count())};
+ }
+ 
+ } // namespace
+ 
+ std::string tiff_index_sidecar_path(const std::string& filepath) {
+     return filepath + ".ifdx";
+ }
+ 
+ TiffDirectoryIndex build_tiff_directory_index(const std::string& filepath) {
      TIFF* tif = TIFFOpen(filepath.c_str(), "r");
      if (!tif) {
          throw std::runtime_error("Error: Could not open TIFF file: " + filepath);
      }
  
-     uint32_t width, height;
-     size_t depth = 0;
-     
+     TiffDirectoryIndex index;
+     TIFFGetField(tif, TIFFTAG_IMAGEWIDTH, &index.width);
+     TIFFGetField(tif, TIFFTAG_IMAGELENGTH, &index.height);
+     TIFFGetFieldDefaulted(tif, TIFFTAG_BITSPERSAMPLE, &index.bits_per_sample);
+ 
+     // A single walk of the IFD chain records every directory offset.
      do {
-         depth++;
+         index.offsets.push_back(TIFFCurrentDirOffset(tif));
      } while (TIFFReadDirectory(tif));
  
-     TIFFSetDirectory(tif, 0);
-     TIFFGetField(tif, TIFFTAG_IMAGEWIDTH, &width);
-     TIFFGetField(tif, TIFFTAG_IMAGELENGTH, &height);
+     TIFFClose(tif);
+     return index;
+ }
  
-     xt::xtensor<T, 3> image = xt::zeros<T>({depth, height, width});
+ void save_tiff_directory_index(const TiffDirectoryIndex& index, const std::string& filepath) {
+     std::string sidecar = tiff_index_sidecar_path(filepath);
+     std::ofstream out(sidecar, std::ios::out | std::ios::binary);
+     if (!out) {
+         throw std::runtime_error("Error: Could not write TIFF index file: " + sidecar);
+     }
  
-     for (size_t d = 0; d < depth; ++d) {
-         TIFFSetDirectory(tif, d);
-         for (uint32_t row = 0; row < height; ++row) {
-             auto row_view = xt::view(image, d, row, xt::all());
-             TIFFReadScanline(tif, row_view.data(), row);
+     auto [file_size, mtime] = tiff_file_signature(filepath);
+     uint64_t depth = index.offsets.size();
+ 
+     out.write(kIndexMagic, sizeof(kIndexMagic));
+     out.write(reinterpret_cast<const char*>(&kIndexVersion), sizeof(kIndexVersion));
+     out.write(reinterpret_cast<const char*>(&file_size), sizeof(file_size));
+     out.write(reinterpret_cast<const char*>(&mtime), sizeof(mtime));
+     out.write(reinterpret_cast<const char*>(&index.width), sizeof(index.width));
+     out.write(reinterpret_cast<const char*>(&index.height), sizeof(index.height));
+     out.write(reinterpret_cast<const char*>(&index.bits_per_sample), sizeof(index.bits_per_sample));
+     out.write(reinterpret_cast<const char*>(&depth), sizeof(depth));
+     out.write(reinterpret_cast<const char*>(index.offsets.data()), depth * sizeof(uint64_t));
+ }
+ 
+ TiffDirectoryIndex load_tiff_directory_index(const std::string& filepath, bool write_sidecar) {
+     std::ifstream in(tiff_index_sidecar_path(filepath), std::ios::in | std::ios::binary);
+     if (in) {
+         char magic[4];
+         uint32_t version = 0;
+         uint64_t file_size = 0, depth = 0;
+         int64_t mtime = 0;
+         TiffDirectoryIndex index;
+ 
+         in.read(magic, sizeof(magic));
+         in.read(reinterpret_cast<char*>(&version), sizeof(version));
+         in.read(reinterpret_cast<char*>(&file_size), sizeof(file_size));
+         in.read(reinterpret_cast<char*>(&mtime), sizeof(mtime));
+         in.read(reinterpret_cast<char*>(&index.width), sizeof(index.width));
+         in.read(reinterpret_cast<char*>(&index.height), sizeof(index.height));
+         in.read(reinterpret_cast<char*>(&index.bits_per_sample), sizeof(index.bits_per_sample));
+         in.read(reinterpret_cast<char*>(&depth), sizeof(depth));
+ 
+         // Only trust the sidecar if it was built for this exact version of the file.
+         bool valid = in && std::equal(magic, magic + 4, kIndexMagic) && version == kIndexVersion &&
+                      std::make_pair(file_size, mtime) == tiff_file_signature(filepath);
+         if (valid) {
+             index.offsets.resize(depth);
+             in.read(reinterpret_cast<char*>(index.offsets.data()), depth * sizeof(uint64_t));
+             if (in) return index;
          }
      }
  
-     TIFFClose(tif);
+     TiffDirectoryIndex index = build_tiff_directory_index(filepath);
+     if (write_sidecar) {
+         try {
+             save_tiff_directory_index(index, filepath);
+         } catch (const std::exception& e) {
+             // The sidecar is only a cache; a read-only data directory must not prevent loading.
+             std::cerr << "Warning: " << e.what() << std::endl;
+         }
+     }
+     return index;
+ }
+ 
+ // --- TIFF Reading ---
+ 
+ namespace {
+ 
+ template<typename T>
+ xt::xtensor<T, 3> read_tiff_slices(const std::string& filepath, const TiffDirectoryIndex& index, size_t z_begin,
+                                    size_t z_end, const SampleConverter<T>* convert, unsigned num_threads) {
+     if (z_begin > z_end || z_end > index.depth()) {
+         throw std::out_of_range("Error: Requested TIFF slice range is outside the image: " + filepath);
+     }
+ 
+     const uint32_t width = index.width;
+     const uint32_t height = index.height;
+     xt::xtensor<T, 3> image = xt::empty<T>({z_end - z_begin, size_t(height), size_t(width)});
+     const size_t slice_size = size_t(height) * width;
+ 
+     // Each worker owns its own TIFF handle and decodes a contiguous range of directories,
+     // so libtiff state is never shared between threads. Directories are reached by a
+     // direct seek to their recorded offset instead of re-walking the IFD chain.
+     parallel_for_chunks(z_begin, z_end, num_threads, [&](size_t first, size_t last, unsigned) {
+         TIFF* worker_tif = TIFFOpen(filepath.c_str(), "r");
+         if (!worker_tif) {
+             throw std::runtime_error("Error: Could not open TIFF file: " + filepath);
+         }
+         std::vector<unsigned char> scratch;
+         try {
+             for (size_t d = first; d < last; ++d) {
+                 if (!TIFFSetSubDirectory(worker_tif, index.offsets[d])) {
+                     throw std::runtime_error("Error: Could not seek to TIFF directory " + std::to_string(d));
+                 }
+                 decode_tiff_directory(worker_tif, image.data() + (d - z_begin) * slice_size, width, height, scratch, convert);
+             }
+         } catch (...) {
+             TIFFClose(worker_tif);
+             throw;
+         }
+         TIFFClose(worker_tif);
+     });
+ 
      return image;
  }
  
+ } // namespace
+ 
  template<typename T>
- void write_tiff_image_xt(const xt::xtensor<T, 3>& image, const std::string& filepath) {
-     TIFF* out = TIFFOpen(filepath.c_str(), "w");
-     if (!out) {
+ xt::xtensor<T, 3> read_tiff_slices_xt(const std::string& filepath, const TiffDirectoryIndex& index,
+                                       size_t z_begin, size_t z_end, unsigned num_threads) {
+     return read_tiff_slices<T>(filepath, index, z_begin, z_end, nullptr, num_threads);
+ }
+ 
+ template<typename T>
+ xt::xtensor<T, 3> read_tiff_slices_xt(const std::string& filepath, const TiffDirectoryIndex& index,
+                                       size_t z_begin, size_t z_end, const VoxelTransform& transform,
+                                       unsigned num_threads) {
+     const SampleConverter<T> convert(transform);
+     return read_tiff_slices<T>(filepath, index, z_begin, z_end, &convert, num_threads);
+ }
+ 
+ template<typename T>
+ xt::xtensor<T, 3> read_tiff_image_xt(const std::string& filepath, unsigned num_threads) {
+     TiffDirectoryIndex index = load_tiff_directory_index(filepath);
+     return read_tiff_slices_xt<T>(filepath, index, 0, index.depth(), num_threads);
+ }
+ 
+ template<typename T>
+ xt::xtensor<T, 3> read_tiff_image_xt(const std::string& filepath, const VoxelTransform& transform, unsigned num_threads) {
+     TiffDirectoryIndex index = load_tiff_directory_index(filepath);
+     return read_tiff_slices_xt<T>(filepath, index, 0, index.depth(), transform, num_threads);
+ }
+ 
+ // --- TIFF Writing ---
+ 
+ namespace {
+ 
+ /// Stacks whose total uncompressed payload (all slices) exceeds this size are written as BigTIFF.
+ constexpr uint64_t kClassicTiffLimit = (uint64_t(1) << 32) - (uint64_t(64) << 20);
+ 
+ /// Target size of one strip when rows_per_strip is left to the writer.
+ constexpr size_t kDefaultStripBytes = 256 * 1024;
+ 
+ uint16_t tiff_compression_code(Compression compression) {
+     switch (compression) {
+         case Compression::LZW:     return COMPRESSION_LZW;
+         case Compression::Deflate: return COMPRESSION_ADOBE_DEFLATE;
+         case Compression::Zstd:    return COMPRESSION_ZSTD;
+         case Compression::None:
+         default:                   return COMPRESSION_NONE;
+     }
+ }
+ 
+ } // namespace
+ 
+ template<typename T>
+ TiffStackWriter<T>::TiffStackWriter(const std::string& filepath, size_t height, size_t width,
+                                     const TiffWriteOptions& options, size_t expected_depth)
+     : filepath_(filepath), height_(height), width_(width), options_(options) {
+     const size_t row_bytes = width_ * options_.samples_per_pixel * sizeof(T);
+     rows_per_strip_ = options_.rows_per_strip;
+     if (rows_per_strip_ == 0) {
+         rows_per_strip_ = static_cast<uint32_t>(std::max<size_t>(1, kDefaultStripBytes / std::max<size_t>(1, row_bytes)));
+     }
+     rows_per_strip_ = static_cast<uint32_t>(std::min<size_t>(rows_per_strip_, std::max<size_t>(1, height_)));
+ 
+     // Strips compressed by our own codecs are written raw; anything else goes through libtiff.
+     in_process_codec_ = codec_is_available(options_.compression);
+     if (!in_process_codec_ && !TIFFIsCODECConfigured(tiff_compression_code(options_.compression))) {
+         throw std::runtime_error("Error: The requested TIFF compression is not available in this libtiff build.");
+     }
+ 
+     // A stack of unknown depth may outgrow the 4 GB offsets of a classic TIFF, so it is written as BigTIFF.
+     const uint64_t payload = uint64_t(expected_depth) * height_ * row_bytes;
+     const bool bigtiff = options_.bigtiff || expected_depth == 0 || payload > kClassicTiffLimit;
+     out_ = TIFFOpen(filepath.c_str(), bigtiff ? "w8" : "w");
+     if (!out_) {
          throw std::runtime_error("Error: Could not open file for writing: " + filepath);
      }
+ }
  
-     auto shape = image.shape();
-     size_t depth = shape[0];
-     size_t height = shape[1];
-     size_t width = shape[2];
- 
-     for (size_t d = 0; d < depth; ++d) {
-         TIFFSetField(out, TIFFTAG_IMAGEWIDTH, width);
-         TIFFSetField(out, TIFFTAG_IMAGELENGTH, height);
-         TIFFSetField(out, TIFFTAG_SAMPLESPERPIXEL, 1);
-         TIFFSetField(out, TIFFTAG_BITSPERSAMPLE, sizeof(T) * 8);
-         TIFFSetField(out, TIFFTAG_ORIENTATION, ORIENTATION_TOPLEFT);
-         TIFFSetField(out, TIFFTAG_PLANARCONFIG, PLANARCONFIG_CONTIG);
-         TIFFSetField(out, TIFFTAG_PHOTOMETRIC, PHOTOMETRIC_MINISBLACK);
-         
-         for (size_t row = 0; row < height; ++row) {
-             auto row_view = xt::view(image, d, row, xt::all());
-             TIFFWriteScanline(out, const_cast<T*>(row_view.data()), row);
+ template<typename T>
+ TiffStackWriter<T>::~TiffStackWriter() {
+     if (out_) TIFFClose(out_);
+ }
+ 
+ template<typename T>
+ void TiffStackWriter<T>::write_directory_fields() {
+     TIFFSetField(out_, TIFFTAG_IMAGEWIDTH, static_cast<uint32_t>(width_));
+     TIFFSetField(out_, TIFFTAG_IMAGELENGTH, static_cast<uint32_t>(height_));
+     TIFFSetField(out_, TIFFTAG_SAMPLESPERPIXEL, static_cast<int>(options_.samples_per_pixel));
+     TIFFSetField(out_, TIFFTAG_BITSPERSAMPLE, static_cast<int>(sizeof(T) * 8));
+     TIFFSetField(out_, TIFFTAG_SAMPLEFORMAT, std::is_signed<T>::value ? SAMPLEFORMAT_INT : SAMPLEFORMAT_UINT);
+     TIFFSetField(out_, TIFFTAG_ORIENTATION, ORIENTATION_TOPLEFT);
+     TIFFSetField(out_, TIFFTAG_PLANARCONFIG, PLANARCONFIG_CONTIG);
+     TIFFSetField(out_, TIFFTAG_PHOTOMETRIC, options_.samples_per_pixel == 3 ? PHOTOMETRIC_RGB : PHOTOMETRIC_MINISBLACK);
+     TIFFSetField(out_, TIFFTAG_COMPRESSION, tiff_compression_code(options_.compression));
+     TIFFSetField(out_, TIFFTAG_ROWSPERSTRIP, rows_per_strip_);
+     if (!in_process_codec_ && options_.compression == Compression::Deflate && options_.level >= 0) {
+         TIFFSetField(out_, TIFFTAG_ZIPQUALITY, options_.level);
+     }
+ }
+ 
+ template<typename T>
+ void TiffStackWriter<T>::append(const T* slices, size_t count) {
+     if (!out_) {
+         throw std::runtime_error("Error: TIFF writer is already closed: " + filepath_);
+     }
+ 
+     const size_t row_size = width_ * options_.samples_per_pixel;
+     const size_t slice_size = height_ * row_size;
+     const size_t strip_size = size_t(rows_per_strip_) * row_size;
+     const size_t strips_per_slice = (height_ + rows_per_strip_ - 1) / rows_per_strip_;
+     auto strip_elements = [&](size_t s) { return std::min(strip_size, slice_size - s * strip_size); };
+ 
+     if (!in_process_codec_ || options_.compression == Compression::None) {
+         // Uncompressed strips are written straight from the tensor; other libtiff codecs
+         // (e.g. LZW) are encoded serially by libtiff itself.
+         for (size_t d = 0; d < count; ++d) {
+             write_directory_fields();
+             T* slice = const_cast<T*>(slices + d * slice_size);
+             for (size_t s = 0; s < strips_per_slice; ++s) {
+                 tmsize_t bytes = static_cast<tmsize_t>(strip_elements(s) * sizeof(T));
+                 tmsize_t written = in_process_codec_
+                     ? TIFFWriteRawStrip(out_, static_cast<tstrip_t>(s), slice + s * strip_size, bytes)
+                     : TIFFWriteEncodedStrip(out_, static_cast<tstrip_t>(s), slice + s * strip_size, bytes);
+                 if (written < 0) {
+                     throw std::runtime_error("Error: Failed to write TIFF strip to " + filepath_);
+                 }
+             }
+             if (!TIFFWriteDirectory(out_)) {
+                 throw std::runtime_error("Error: Failed to write TIFF directory to " + filepath_);
+             }
+             ++depth_;
          }
-         TIFFWriteDirectory(out);
+         return;
      }
  
-     TIFFClose(out);
+     // Compress a batch of slices on all threads, then write its strips in order.
+     // Batching bounds the memory held by compressed strips that are not yet written.
+     const unsigned threads = resolve_thread_count(options_.num_threads, count * strips_per_slice);
+     const size_t batch_slices = std::max<size_t>(1, (size_t(threads) * 4 + strips_per_slice - 1) / strips_per_slice);
+     std::vector<std::vector<unsigned char>> compressed;
+ 
+     for (size_t batch_begin = 0; batch_begin < count; batch_begin += batch_slices) {
+         const size_t batch_end = std::min(count, batch_begin + batch_slices);
+         const size_t batch_strips = (batch_end - batch_begin) * strips_per_slice;
+         compressed.assign(batch_strips, {});
+ 
+         parallel_for(0, batch_strips, threads, [&](size_t i) {
+             size_t d = batch_begin + i / strips_per_slice;
+             size_t s = i % strips_per_slice;
+             const T* strip = slices + d * slice_size + s * strip_size;
+             compressed[i] = compress_buffer(strip, strip_elements(s) * sizeof(T), options_.compression, options_.level);
+         });
+ 
+         for (size_t d = batch_begin; d < batch_end; ++d) {
+             write_directory_fields();
+             for (size_t s = 0; s < strips_per_slice; ++s) {
+                 auto& block = compressed[(d - batch_begin) * strips_per_slice + s];
+                 if (TIFFWriteRawStrip(out_, static_cast<tstrip_t>(s), block.data(), static_cast<tmsize_t>(block.size())) < 0) {
+                     throw std::runtime_error("Error: Failed to write TIFF strip to " + filepath_);
+                 }
+             }
+             if (!TIFFWriteDirectory(out_)) {
+                 throw std::runtime_error("Error: Failed to write TIFF directory to " + filepath_);
+             }
+             ++depth_;
+         }
+     }
  }
  
- xt::xtensor<uint8_t, 3> dilate_with_ball(const xt::xtensor<uint8_t, 3>& image, float radius) {
-     // TODO: Substitua este placeholder pela chamada real da função de dilatação da biblioteca PINK.
-     std::cout << "[INFO] Placeholder for PINK Dilation with ball of radius " << radius << std::endl;
-     // Por enquanto, apenas retorna a imagem original
-     return image;
+ template<typename T>
+ void TiffStackWriter<T>::append(const xt::xtensor<T, 3>& slices) {
+     if (slices.shape()[1] != height_ || slices.shape()[2] != width_ || options_.samples_per_pixel != 1) {
+         throw std::invalid_argument("Error: Slice dimensions do not match the TIFF being written: " + filepath_);
+     }
+     append(slices.data(), slices.shape()[0]);
+ }
+ 
+ template<typename T>
+ void TiffStackWriter<T>::close() {
+     if (out_) {
+         TIFFClose(out_);
+         out_ = nullptr;
+     }
+ }
+ 
+ void write_rgb_tiff_image_xt(const xt::xtensor<uint8_t, 4>& image, const std::string& filepath, TiffWriteOptions options) {
+     auto shape = image.shape();
+     if (shape[3] != 3) {
+         throw std::invalid_argument("Error: RGB images must have 3 channels: " + filepath);
+     }
+     options.samples_per_pixel = 3;
+     TiffStackWriter<uint8_t> writer(filepath, shape[1], shape[2], options, shape[0]);
+     writer.append(image.data(), shape[0]);
+     writer.close();
+ }
+ 
+ template<typename T>
+ void write_tiff_image_xt(const xt::xtensor<T, 3>& image, const std::string& filepath, const TiffWriteOptions& options) {
+     auto shape = image.shape();
+     TiffStackWriter<T> writer(filepath, shape[1], shape[2], options, shape[0]);
+     writer.append(image);
+     writer.close();
+ }
+ 
+ xt::xtensor<uint8_t, 3> dilate_with_ball(const xt::xtensor<uint8_t, 3>& image, float radius, unsigned num_threads) {
+     xt::xtensor<uint8_t, 3> dilated = image;
+     Mask3D mask = borrow_volume(dilated);
+     dilate_ball(mask, radius, num_threads);
+     return dilated;
+ }
+ 
+ xt::xtensor<uint8_t, 3> erode_with_ball(const xt::xtensor<uint8_t, 3>& image, float radius, unsigned num_threads) {
+     xt::xtensor<uint8_t, 3> eroded = image;
+     Mask3D mask = borrow_volume(eroded);
+     erode_ball(mask, radius, num_threads);
+     return eroded;
+ }
+ 
+ xt::xtensor<uint32_t, 3> label_components(const xt::xtensor<uint8_t, 3>& image, int& num_components,
+                                           int connectivity, unsigned num_threads) {
+     size_t count = 0;
+     Labels3D labels = label_connected_components(borrow_volume(image), connectivity, count, num_threads);
+     num_components = static_cast<int>(count);
+     return as_xtensor(labels);
+ }
+ 
+ std::vector<Centroid> calculate_centroids(const xt::xtensor<uint32_t, 3>& labels, unsigned num_threads) {
+     return calculate_centroids(borrow_volume(labels), num_threads);
+ }
+ 
+ std::vector<Centroid> calculate_centroids(const Volume<uint32_t>& labels, unsigned num_threads) {
+     std::vector<Centroid> centroids;
+     for (const RegionMoments& region : compute_region_moments(labels, num_threads)) {
+         if (region.volume == 0) continue;
+         const std::array<double, 3> mean = region.centroid();
+         centroids.push_back({static_cast<int>(mean[0]), static_cast<int>(mean[1]), static_cast<int>(mean[2]),
+                              static_cast<int>(region.label)});
+     }
+     return centroids;
+ }
+ 
+ void write_centroids_csv(const std::string& filepath, const std::vector<Centroid>& centroids) {
+     std::ofstream file(filepath);
+     if (!file.is_open()) {
+         throw std::runtime_error("Error: Could not create output file: " + filepath);
+     }
+     file << "X,Y,Z,Label\n";
+     for (const auto& c : centroids) {
+         file << c.x << "," << c.y << "," << c.z << "," << c.label << "\n";
+     }
+     if (!file) {
+         throw std::runtime_error("Error: Failed to write centroids to " + filepath);
+     }
  }
  
- xt::xtensor<uint32_t, 3> label_components(const xt::xtensor<uint8_t, 3>& image, int& num_components) {
-     // TODO: Substitua este placeholder pela chamada real da função de rotulação da biblioteca PINK.
-     std::cout << "[INFO] Placeholder for PINK Label Components" << std::endl;
-     num_components = 5; // Valor de exemplo
-     // Por enquanto, apenas converte a imagem de entrada para um formato de rótulo (uint32_t)
-     return xt::cast<uint32_t>(image);
- }
\ No newline at end of file
+ // Explicit class template instantiations (after the member definitions, so every member is emitted)
+ template class TiffStackWriter<uint8_t>;
+ template class TiffStackWriter<uint16_t>;
+ template class TiffStackWriter<uint32_t>;
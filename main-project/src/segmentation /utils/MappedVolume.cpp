@@ -0,0 +1,228 @@
+/**
+ * @file MappedVolume.cpp
+ * @brief Implements memory-mapped loading of uncompressed TIFF and raw volumes.
+ */
+
+ #include "MappedVolume.h"
+ #include "ImageProcessingUtils.h"
+ #include <tiffio.h>
+ #include <sys/mman.h>
+ #include <sys/stat.h>
+ #include <fcntl.h>
+ #include <unistd.h>
+ #include <stdexcept>
+ #include <utility>
+ #include <algorithm>
+ #include <type_traits>
+
+ namespace {
+
+ /**
+  * @brief Maps [offset, offset + length) of a file read-only.
+  * @param filepath The file to map.
+  * @param offset The byte offset of the first byte of interest.
+  * @param length The number of bytes of interest.
+  * @param mapping Receives the start of the page-aligned mapping.
+  * @param mapping_length Receives the length of the mapping.
+  * @return A pointer to the byte at `offset` inside the mapping.
+  */
+ const unsigned char* map_file_range(const std::string& filepath, uint64_t offset, size_t length,
+                                     void*& mapping, size_t& mapping_length) {
+     int fd = open(filepath.c_str(), O_RDONLY);
+     if (fd < 0) {
+         throw std::runtime_error("Error: Could not open file for mapping: " + filepath);
+     }
+
+     // mmap offsets must be page aligned; map from the enclosing page boundary.
+     const uint64_t page = static_cast<uint64_t>(sysconf(_SC_PAGESIZE));
+     const uint64_t aligned_offset = offset - (offset % page);
+     const size_t lead = static_cast<size_t>(offset - aligned_offset);
+
+     mapping_length = lead + length;
+     mapping = mmap(nullptr, mapping_length, PROT_READ, MAP_PRIVATE, fd, static_cast<off_t>(aligned_offset));
+     close(fd); // The mapping keeps its own reference to the file.
+
+     if (mapping == MAP_FAILED) {
+         mapping = nullptr;
+         mapping_length = 0;
+         throw std::runtime_error("Error: Could not memory-map file: " + filepath);
+     }
+     madvise(mapping, mapping_length, MADV_SEQUENTIAL);
+     return static_cast<const unsigned char*>(mapping) + lead;
+ }
+
+ /**
+  * @brief Checks whether every voxel of a TIFF stack is stored uncompressed and back to back.
+  * @param filepath The path to the TIFF file.
+  * @param index The directory index of the file.
+  * @param bytes_per_sample The expected number of bytes per voxel.
+  * @param sample_format The SAMPLEFORMAT of the voxel type; unsigned samples are also accepted
+  * for integer voxel types, as the copying reader does.
+  * @param data_offset Receives the file offset of the first voxel when the check succeeds.
+  * @return True if the whole volume is one contiguous, native-endian block of raw samples.
+  */
+ bool find_contiguous_tiff_payload(const std::string& filepath, const TiffDirectoryIndex& index,
+                                   size_t bytes_per_sample, uint16_t sample_format, uint64_t& data_offset) {
+     TIFF* tif = TIFFOpen(filepath.c_str(), "r");
+     if (!tif) {
+         throw std::runtime_error("Error: Could not open TIFF file: " + filepath);
+     }
+
+     const uint64_t row_bytes = uint64_t(index.width) * bytes_per_sample;
+     uint64_t expected = 0;
+     bool contiguous = true;
+
+     for (size_t d = 0; d < index.depth() && contiguous; ++d) {
+         if (!TIFFSetSubDirectory(tif, index.offsets[d])) {
+             contiguous = false;
+             break;
+         }
+
+         uint32_t width = 0, height = 0, rows_per_strip = 0;
+         uint16_t compression = 0, bits_per_sample = 0, format = SAMPLEFORMAT_UINT, samples_per_pixel = 0, planar = 0;
+         TIFFGetField(tif, TIFFTAG_IMAGEWIDTH, &width);
+         TIFFGetField(tif, TIFFTAG_IMAGELENGTH, &height);
+         TIFFGetFieldDefaulted(tif, TIFFTAG_COMPRESSION, &compression);
+         TIFFGetFieldDefaulted(tif, TIFFTAG_BITSPERSAMPLE, &bits_per_sample);
+         TIFFGetFieldDefaulted(tif, TIFFTAG_SAMPLEFORMAT, &format);
+         TIFFGetFieldDefaulted(tif, TIFFTAG_SAMPLESPERPIXEL, &samples_per_pixel);
+         TIFFGetFieldDefaulted(tif, TIFFTAG_PLANARCONFIG, &planar);
+         TIFFGetFieldDefaulted(tif, TIFFTAG_ROWSPERSTRIP, &rows_per_strip);
+
+         if (width != index.width || height != index.height || compression != COMPRESSION_NONE ||
+             bits_per_sample != bytes_per_sample * 8 || samples_per_pixel != 1 ||
+             (format != sample_format && !(format == SAMPLEFORMAT_UINT && sample_format != SAMPLEFORMAT_IEEEFP)) ||
+             planar != PLANARCONFIG_CONTIG || TIFFIsTiled(tif) || TIFFIsByteSwapped(tif)) {
+             contiguous = false;
+             break;
+         }
+
+         // Every strip must start exactly where the previous one (of any slice) ended.
+         rows_per_strip = std::min(rows_per_strip, height);
+         const uint32_t num_strips = TIFFNumberOfStrips(tif);
+         for (uint32_t s = 0; s < num_strips; ++s) {
+             uint64_t strip_offset = TIFFGetStrileOffset(tif, s);
+             uint64_t rows = std::min<uint64_t>(rows_per_strip, height - uint64_t(s) * rows_per_strip);
+             if (d == 0 && s == 0) {
+                 data_offset = strip_offset;
+                 expected = strip_offset;
+             }
+             if (strip_offset != expected || TIFFGetStrileByteCount(tif, s) < rows * row_bytes) {
+                 contiguous = false;
+                 break;
+             }
+             expected += rows * row_bytes;
+         }
+     }
+
+     TIFFClose(tif);
+     return contiguous && index.depth() > 0;
+ }
+
+ /**
+  * @brief Returns the SAMPLEFORMAT that stores values of type T as-is.
+  */
+ template<typename T>
+ uint16_t sample_format_of() {
+     if (std::is_floating_point<T>::value) return SAMPLEFORMAT_IEEEFP;
+     return std::is_signed<T>::value ? SAMPLEFORMAT_INT : SAMPLEFORMAT_UINT;
+ }
+
+ } // namespace
+
+
+ template<typename T>
+ MappedVolume<T> MappedVolume<T>::open_tiff(const std::string& filepath, unsigned num_threads) {
+     MappedVolume volume;
+     TiffDirectoryIndex index = load_tiff_directory_index(filepath);
+     volume.shape_ = {index.depth(), size_t(index.height), size_t(index.width)};
+
+     uint64_t data_offset = 0;
+     if (find_contiguous_tiff_payload(filepath, index, sizeof(T), sample_format_of<T>(), data_offset) && data_offset % alignof(T) == 0) {
+         const unsigned char* bytes = map_file_range(filepath, data_offset, volume.size() * sizeof(T),
+                                                     volume.mapping_, volume.mapping_length_);
+         volume.data_ = reinterpret_cast<const T*>(bytes);
+         return volume;
+     }
+
+     // Compressed, tiled or fragmented files are decoded into owned memory instead.
+     volume.owned_ = read_tiff_slices_xt<T>(filepath, index, 0, index.depth(), num_threads);
+     volume.data_ = volume.owned_.data();
+     return volume;
+ }
+
+ template<typename T>
+ MappedVolume<T> MappedVolume<T>::open_tiff(const std::string& filepath, const VoxelTransform& transform,
+                                            unsigned num_threads) {
+     if (transform.kind == VoxelTransform::Kind::Identity) return open_tiff(filepath, num_threads);
+
+     MappedVolume volume;
+     TiffDirectoryIndex index = load_tiff_directory_index(filepath);
+     volume.shape_ = {index.depth(), size_t(index.height), size_t(index.width)};
+     volume.owned_ = read_tiff_slices_xt<T>(filepath, index, 0, index.depth(), transform, num_threads);
+     volume.data_ = volume.owned_.data();
+     return volume;
+ }
+
+ template<typename T>
+ MappedVolume<T> MappedVolume<T>::open_raw(const std::string& filepath, size_t depth, size_t height, size_t width,
+                                           size_t header_bytes) {
+     MappedVolume volume;
+     volume.shape_ = {depth, height, width};
+
+     struct stat st;
+     if (stat(filepath.c_str(), &st) != 0) {
+         throw std::runtime_error("Error: Could not open raw file: " + filepath);
+     }
+     const size_t payload = volume.size() * sizeof(T);
+     if (static_cast<uint64_t>(st.st_size) < header_bytes + payload) {
+         throw std::runtime_error("Error: Raw file is smaller than the requested volume: " + filepath);
+     }
+     if (payload == 0) return volume;
+
+     const unsigned char* bytes = map_file_range(filepath, header_bytes, payload,
+                                                 volume.mapping_, volume.mapping_length_);
+     volume.data_ = reinterpret_cast<const T*>(bytes);
+     return volume;
+ }
+
+ template<typename T>
+ MappedVolume<T>::MappedVolume(MappedVolume&& other) noexcept {
+     *this = std::move(other);
+ }
+
+ template<typename T>
+ MappedVolume<T>& MappedVolume<T>::operator=(MappedVolume&& other) noexcept {
+     if (this != &other) {
+         release();
+         mapping_ = std::exchange(other.mapping_, nullptr);
+         mapping_length_ = std::exchange(other.mapping_length_, 0);
+         shape_ = std::exchange(other.shape_, {});
+         owned_ = std::move(other.owned_);
+         // The owned buffer moved with the tensor, so re-derive the pointer from it.
+         data_ = mapping_ ? std::exchange(other.data_, nullptr) : owned_.data();
+         other.data_ = nullptr;
+     }
+     return *this;
+ }
+
+ template<typename T>
+ MappedVolume<T>::~MappedVolume() {
+     release();
+ }
+
+ template<typename T>
+ void MappedVolume<T>::release() {
+     if (mapping_) {
+         munmap(mapping_, mapping_length_);
+         mapping_ = nullptr;
+         mapping_length_ = 0;
+     }
+     data_ = nullptr;
+ }
+
+ // Explicit template instantiations (after the member definitions, so every member is emitted)
+ template class MappedVolume<uint8_t>;
+ template class MappedVolume<uint16_t>;
+ template class MappedVolume<int16_t>;
+ template class MappedVolume<uint32_t>;
@@ -0,0 +1,262 @@
+/**
+ * @file SlabStream.cpp
+ * @brief Implements the slab sinks and the streaming versions of the voxelwise stages.
+ */
+
+ #include "SlabStream.h"
+ #include "common.hpp" // For Volume, erosion() and IncrementalErosion
+ #include "connected_components.hpp"
+ #include "volume_xtensor.hpp"
+ #include <iostream>
+ #include <random>
+ #include <set>
+ #include <unordered_map>
+
+ // --- BrickSlabSink ---
+
+ template<typename T>
+ void BrickSlabSink<T>::write(const xt::xtensor<T, 3>& slices) {
+     pending_.insert(pending_.end(), slices.data(), slices.data() + slices.size());
+     flush_layers(false);
+ }
+
+ template<typename T>
+ void BrickSlabSink<T>::finish() {
+     flush_layers(true);
+     writer_.close();
+ }
+
+ template<typename T>
+ void BrickSlabSink<T>::flush_layers(bool final) {
+     const auto& info = writer_.info();
+     const size_t slice_size = info.shape[1] * info.shape[2];
+     const size_t pending_slices = slice_size ? pending_.size() / slice_size : 0;
+
+     // Store whole brick layers; the last, partial layer is only stored at the end.
+     size_t slices = (pending_slices / info.brick_shape[0]) * info.brick_shape[0];
+     if (final) slices = pending_slices;
+     if (slices == 0) return;
+
+     xt::xtensor<T, 3> layer = xt::empty<T>({slices, info.shape[1], info.shape[2]});
+     std::copy_n(pending_.data(), layer.size(), layer.data());
+     writer_.write_slab(pending_begin_, layer, num_threads_);
+
+     pending_.erase(pending_.begin(), pending_.begin() + layer.size());
+     pending_begin_ += slices;
+ }
+
+
+ // --- Voxelwise Stages ---
+
+ template<typename T>
+ void stream_binarization(const SlabSource<T>& source, SlabSink<uint8_t>& sink, int threshold, size_t slab) {
+     stream_slabs(source, sink, slab, 0, [&](const xt::xtensor<T, 3>& in, const SlabWindow&, xt::xtensor<uint8_t, 3>& out) {
+         const T* src = in.data();
+         uint8_t* dst = out.data();
+         for (size_t i = 0; i < out.size(); ++i) {
+             dst[i] = static_cast<int64_t>(src[i]) >= threshold ? 255 : 0;
+         }
+     });
+ }
+
+ template<typename T>
+ void stream_binary_sum(const SlabSource<T>& first, const SlabSource<T>& second, SlabSink<uint8_t>& sink, size_t slab) {
+     if (first.shape() != second.shape()) {
+         throw std::invalid_argument("Error: Input image dimensions do not match!");
+     }
+     // The second input is read window by window alongside the first one.
+     stream_slabs(first, sink, slab, 0, [&](const xt::xtensor<T, 3>& a, const SlabWindow& window, xt::xtensor<uint8_t, 3>& out) {
+         xt::xtensor<T, 3> b = second.read(window.z_begin, window.z_end);
+         for (size_t i = 0; i < out.size(); ++i) {
+             out.data()[i] = (a.data()[i] >= 255 || b.data()[i] >= 255) ? 255 : 0;
+         }
+     });
+ }
+
+ namespace {
+
+ /**
+  * @brief Copies a loaded slab into a label volume with the same memory layout (i = slice).
+  */
+ Labels3D slab_to_volume(const xt::xtensor<uint32_t, 3>& slab) {
+     return {std::vector<uint32_t>(slab.begin(), slab.end()),
+             static_cast<long>(slab.shape()[0]), static_cast<long>(slab.shape()[1]), static_cast<long>(slab.shape()[2])};
+ }
+
+ } // namespace
+
+ void stream_erosion(const SlabSource<uint32_t>& source, SlabSink<uint32_t>& sink, size_t slab) {
+     stream_slabs(source, sink, slab, 1, [](const xt::xtensor<uint32_t, 3>& in, const SlabWindow& window, xt::xtensor<uint32_t, 3>& out) {
+         // The one-slice halo gives erosion() the true neighbours of the first and last core slices.
+         Labels3D eroded = erosion(slab_to_volume(in));
+         const size_t offset = window.halo_before() * in.shape()[1] * in.shape()[2];
+         std::copy_n(eroded.data.begin() + offset, out.size(), out.data());
+     });
+ }
+
+ std::map<std::pair<int, int>, int> stream_contact_detection_naive(const SlabSource<uint32_t>& labels,
+                                                                   size_t slab, size_t halo) {
+     std::map<std::pair<int, int>, int> contactsStrength;
+     const int max_level = static_cast<int>(halo) + 1;
+     bool capped = false;
+
+     const long offsets[6][3] = {
+         {-1, 0, 0}, {1, 0, 0}, {0, -1, 0},
+         {0, 1, 0}, {0, 0, -1}, {0, 0, 1}
+     };
+
+     for_each_slab(labels, slab, halo, [&](const xt::xtensor<uint32_t, 3>& in, const SlabWindow& window) {
+         const Labels3D input_image = slab_to_volume(in);
+         const size_t slice = size_t(input_image.y_dim) * input_image.z_dim;
+         const size_t core_begin = window.halo_before() * slice;
+         const size_t core_end = core_begin + window.core_depth() * slice;
+
+         // A voxel of the core touching a larger label records `level` as the pair's strength.
+         auto record = [&](size_t idx, int level) {
+             if (idx < core_begin || idx >= core_end) return;
+             const long i = idx / slice, j = (idx / input_image.z_dim) % input_image.y_dim, k = idx % input_image.z_dim;
+             const int label = static_cast<int>(input_image.data[idx]);
+             for (const auto& o : offsets) {
+                 long ni = i + o[0], nj = j + o[1], nk = k + o[2];
+                 if (ni < 0 || ni >= input_image.x_dim || nj < 0 || nj >= input_image.y_dim || nk < 0 || nk >= input_image.z_dim) {
+                     continue;
+                 }
+                 int neighbor = static_cast<int>(input_image.at(ni, nj, nk));
+                 if (neighbor == 0 || label >= neighbor) continue;
+                 int& strength = contactsStrength[{label, neighbor}];
+                 strength = std::max(strength, level);
+                 if (level == max_level) capped = true;
+             }
+         };
+
+         // Same result as run_contact_detection_naive restricted to the core slices: a voxel peeled
+         // by the n-th erosion is present at levels 1..n, so only the peeled shell is rechecked.
+         IncrementalErosion<uint32_t> peel(input_image);
+         for (int level = 1; level < max_level && !peel.done(); ++level) {
+             for (size_t idx : peel.step()) record(idx, level);
+         }
+         // Whatever is left reaches the last measurable level (everything, if there is no background).
+         if (!peel.done() || peel.level() == 0) {
+             const auto& remaining = peel.current().data;
+             for (size_t idx = core_begin; idx < core_end; ++idx) {
+                 if (remaining[idx] != 0) record(idx, max_level);
+             }
+         }
+     });
+
+     if (capped) {
+         std::cerr << "Warning: Some contacts are stronger than the slab halo allows to measure; "
+                   << "their strength is reported as " << max_level << "." << std::endl;
+     }
+     return contactsStrength;
+ }
+
+ template<typename T>
+ size_t stream_label_components(const SlabSource<T>& image, SlabSink<uint32_t>& sink, int connectivity,
+                                size_t slab, unsigned num_threads) {
+     const auto shape = image.shape();
+     const size_t ny = shape[1], nz = shape[2];
+     const size_t slice = ny * nz;
+
+     // Neighbours of a voxel in the previous slice, as (dj, dk).
+     std::vector<std::pair<int, int>> face;
+     for (int dj = -1; dj <= 1; ++dj) {
+         for (int dk = -1; dk <= 1; ++dk) {
+             const int order = 1 + (dj != 0) + (dk != 0);
+             if (connectivity == 26 || (connectivity == 18 && order <= 2) || order == 1) face.push_back({dj, dk});
+         }
+     }
+
+     // --- Pass 1: Per-Slab Components and Face Equivalences ---
+     // Component c (1-based) of the slab starting at slab_offsets[s] is global provisional label slab_offsets[s] + c - 1.
+     std::vector<uint32_t> slab_offsets;
+     LabelEquivalences global;
+     std::vector<uint32_t> previous_slice; // Global provisional labels (+1) of the previous slab's last slice.
+     for_each_slab(image, slab, 0, [&](const xt::xtensor<T, 3>& in, const SlabWindow& window) {
+         size_t count = 0;
+         const Labels3D local = label_connected_components(borrow_volume(in), connectivity, count, num_threads);
+         const uint32_t offset = static_cast<uint32_t>(global.size());
+         slab_offsets.push_back(offset);
+         for (size_t c = 0; c < count; ++c) global.add();
+
+         if (!previous_slice.empty()) {
+             for (size_t j = 0; j < ny; ++j) {
+                 for (size_t k = 0; k < nz; ++k) {
+                     const uint32_t label = local.data[j * nz + k];
+                     if (label == 0) continue;
+                     for (const auto& d : face) {
+                         const size_t nj = j + d.first, nk = k + d.second; // j - 1 and k - 1 wrap around past the bounds
+                         if (nj >= ny || nk >= nz || previous_slice[nj * nz + nk] == 0) continue;
+                         global.unite(previous_slice[nj * nz + nk] - 1, offset + label - 1);
+                     }
+                 }
+             }
+         }
+         const uint32_t* last = local.data.data() + (window.core_depth() - 1) * slice;
+         previous_slice.resize(slice);
+         for (size_t n = 0; n < slice; ++n) previous_slice[n] = last[n] == 0 ? 0 : offset + last[n];
+     });
+     const size_t num_components = global.compact();
+
+     // --- Pass 2: Global Labels ---
+     // Labeling a slab is deterministic, so the second pass finds the same per-slab components.
+     size_t s = 0;
+     stream_slabs(image, sink, slab, 0, [&](const xt::xtensor<T, 3>& in, const SlabWindow&, xt::xtensor<uint32_t, 3>& out) {
+         size_t count = 0;
+         const Labels3D local = label_connected_components(borrow_volume(in), connectivity, count, num_threads);
+         const uint32_t offset = slab_offsets[s++];
+         uint32_t* dst = out.data();
+         for (size_t n = 0; n < out.size(); ++n) {
+             dst[n] = local.data[n] == 0 ? 0 : global.set_of(offset + local.data[n] - 1) + 1;
+         }
+     });
+     return num_components;
+ }
+
+ void stream_colormap(const SlabSource<uint32_t>& labels, const std::string& output_path,
+                      size_t slab, const TiffWriteOptions& options) {
+     // --- Pass 1: Collect Labels ---
+     std::set<uint32_t> unique_labels;
+     for_each_slab(labels, slab, 0, [&](const xt::xtensor<uint32_t, 3>& in, const SlabWindow&) {
+         unique_labels.insert(in.begin(), in.end());
+     });
+
+     std::random_device rd;
+     std::mt19937 gen(rd());
+     std::uniform_int_distribution<> distrib(0, 255);
+
+     std::unordered_map<uint32_t, std::array<uint8_t, 3>> lut;
+     for (uint32_t label : unique_labels) {
+         lut[label] = {(uint8_t)distrib(gen), (uint8_t)distrib(gen), (uint8_t)distrib(gen)};
+     }
+     lut[0] = {0, 0, 0};
+
+     // --- Pass 2: Apply Colormap ---
+     auto shape = labels.shape();
+     TiffWriteOptions rgb_options = options;
+     rgb_options.samples_per_pixel = 3;
+     TiffStackWriter<uint8_t> writer(output_path, shape[1], shape[2], rgb_options, shape[0]);
+     std::vector<uint8_t> colored;
+
+     for_each_slab(labels, slab, 0, [&](const xt::xtensor<uint32_t, 3>& in, const SlabWindow& window) {
+         colored.resize(in.size() * 3);
+         for (size_t i = 0; i < in.size(); ++i) {
+             const auto& color = lut.at(in.data()[i]);
+             std::copy(color.begin(), color.end(), colored.begin() + 3 * i);
+         }
+         writer.append(colored.data(), window.core_depth());
+     });
+     writer.close();
+ }
+
+
+ // Explicit template instantiations (after the definitions, so every member is emitted)
+ template class BrickSlabSink<uint8_t>;
+ template class BrickSlabSink<uint16_t>;
+ template class BrickSlabSink<uint32_t>;
+ template void stream_binarization<uint8_t>(const SlabSource<uint8_t>&, SlabSink<uint8_t>&, int, size_t);
+ template void stream_binarization<uint16_t>(const SlabSource<uint16_t>&, SlabSink<uint8_t>&, int, size_t);
+ template void stream_binary_sum<uint8_t>(const SlabSource<uint8_t>&, const SlabSource<uint8_t>&, SlabSink<uint8_t>&, size_t);
+ template void stream_binary_sum<uint16_t>(const SlabSource<uint16_t>&, const SlabSource<uint16_t>&, SlabSink<uint8_t>&, size_t);
+ template size_t stream_label_components<uint8_t>(const SlabSource<uint8_t>&, SlabSink<uint32_t>&, int, size_t, unsigned);
+ template size_t stream_label_components<uint32_t>(const SlabSource<uint32_t>&, SlabSink<uint32_t>&, int, size_t, unsigned);
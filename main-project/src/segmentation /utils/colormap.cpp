@@ -23,6 +23,7 @@
  
  // Project utils
  #include "ImageProcessingUtils.h"
+ #include "MappedVolume.h"
  
  int main(int argc, char* argv[]) {
      if (argc != 2) {
@@ -33,8 +34,10 @@
      std::string image_filepath = argv[1];
  
      // --- 1. Load Image ---
-     // We load as uint32_t to support a large number of labels
-     auto image = read_tiff_image_xt<uint32_t>(image_filepath);
+     // We load as uint32_t to support a large number of labels.
+     // The labels are only read, so an uncompressed image is mapped instead of copied.
+     auto labels = MappedVolume<uint32_t>::open_tiff(image_filepath);
+     auto image = labels.view();
      std::cout << "Loaded image with shape: " << image.shape()[0] << "x" << image.shape()[1] << "x" << image.shape()[2] << std::endl;
  
      // --- 2. Create Colormap (Look-Up Table) ---
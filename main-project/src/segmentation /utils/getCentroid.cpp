@@ -19,6 +19,7 @@
  
  // Project utils
  #include "ImageProcessingUtils.h"
+ #include "MappedVolume.h"
  
  int main(int argc, char* argv[]) {
      if (argc != 3) {
@@ -45,7 +46,8 @@
      // --- 2. Ler a imagem segmentada ---
      // O nome do arquivo de saída do max_tree_segmenter é fixo: "maxTree_result.tif"
      std::string mintree_image_path = "maxTree_result.tif";
-     auto mintree_image = read_tiff_image_xt<uint32_t>(mintree_image_path);
+     // The labels are only read, so an uncompressed result is mapped instead of copied.
+     auto mintree_image = MappedVolume<uint32_t>::open_tiff(mintree_image_path);
  
      // --- 3. Encontrar e rotular componentes ---
      // A imagem já está rotulada pelo passo anterior, então podemos pular a rotulação separada.
@@ -53,7 +55,7 @@
      // xt::xtensor<uint8_t, 3> binary_image = mintree_image > 0;
      // int num_components = 0;
      // auto labeled_image = label_components(binary_image, num_components);
-     auto& labeled_image = mintree_image; // Reutilizando a imagem já rotulada.
+     const Volume<uint32_t> labeled_image = borrow_volume(mintree_image); // Reutilizando a imagem já rotulada.
  
      // --- 4. Calcular os centroides ---
      std::vector<Centroid> centroids = calculate_centroids(labeled_image);